@@ -0,0 +1,96 @@
+/*
+Part of the Fluid Corpus Manipulation Project (http://www.flucoma.org/)
+Copyright 2017-2019 University of Huddersfield.
+Licensed under the BSD-3 License.
+See license.md file in the project root for full license information.
+This project has received funding from the European Research Council (ERC)
+under the European Union’s Horizon 2020 research and innovation programme
+(grant agreement No 725899).
+*/
+
+/*
+This program checks that a model published to a real-time reader through
+ModelHandoff is seen by the reader's next acquire(), whatever the reader did
+in between. It exits with a non-zero status if any check fails
+*/
+
+#include <clients/common/ModelHandoff.hpp>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+
+using fluid::client::ModelHandoff;
+
+static int failures = 0;
+
+void check(bool condition, const std::string& what)
+{
+  std::cout << (condition ? "ok   " : "FAIL ") << what << "\n";
+  if (!condition) failures++;
+}
+
+int main()
+{
+  ModelHandoff<int> handoff;
+  check(handoff.acquire() == nullptr, "nothing to acquire before a publish");
+
+  handoff.publish(1);
+  check(*handoff.acquire() == 1, "first model is acquired");
+
+  // the reader has parked its old model; the writer collects and the reader
+  // swaps again before the next publish, parking another
+  handoff.publish(2);
+  handoff.collect();
+  check(*handoff.acquire() == 2, "second model is acquired");
+  handoff.publish(3);
+  check(*handoff.acquire() == 3, "publish takes effect on the next acquire");
+  check(*handoff.acquire() == 3, "acquire keeps the current model");
+
+  // copies the reader never picked up are replaced by the newest
+  handoff.publish(4);
+  handoff.publish(5);
+  check(*handoff.acquire() == 5, "newest of several publishes is acquired");
+
+  for (int i = 6; i < 100; i++)
+  {
+    handoff.publish(std::make_unique<int>(i));
+    if (*handoff.acquire() != i)
+    {
+      check(false, "publish " + std::to_string(i) + " was missed");
+      break;
+    }
+  }
+
+  // with the reader spinning on another thread, every publish must reach it
+  // without the writer doing anything more
+  ModelHandoff<int> shared;
+  std::atomic<int>  seen{-1};
+  std::atomic<bool> done{false};
+  std::thread       reader([&] {
+    while (!done)
+    {
+      int* model = shared.acquire();
+      if (model) seen = *model;
+      std::this_thread::yield();
+    }
+  });
+  bool stalled = false;
+  for (int i = 0; i < 20000 && !stalled; i++)
+  {
+    shared.publish(i);
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+    while (seen != i && !stalled)
+    {
+      std::this_thread::yield();
+      stalled = std::chrono::steady_clock::now() > deadline;
+    }
+  }
+  done = true;
+  reader.join();
+  check(!stalled, "concurrent reader sees every publish");
+
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,182 @@
+/*
+Part of the Fluid Corpus Manipulation Project (http://www.flucoma.org/)
+Copyright 2017-2019 University of Huddersfield.
+Licensed under the BSD-3 License.
+See license.md file in the project root for full license information.
+This project has received funding from the European Research Council (ERC)
+under the European Union’s Horizon 2020 research and innovation programme
+(grant agreement No 725899).
+*/
+
+/*
+This program checks the approximate (HNSW) nearest neighbour search against
+the exact KDTree search on random data: recall for k nearest, completeness of
+radius searches, and a JSON round trip of the graph, which must also be
+validated inside saved KNN models. It exits with a non-zero
+status if any check fails
+*/
+
+#include <algorithms/public/KDTree.hpp>
+#include <algorithms/public/NeighbourIndex.hpp>
+#include <clients/nrt/KNNClassifierClient.hpp>
+#include <clients/nrt/KNNRegressorClient.hpp>
+#include <data/FluidDataSet.hpp>
+#include <data/FluidIndex.hpp>
+#include <data/FluidJSON.hpp>
+#include <data/TensorTypes.hpp>
+#include <iostream>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+using DataSet = fluid::FluidDataSet<std::string, double, 1>;
+using Neighbours = std::vector<std::pair<double, fluid::index>>;
+using fluid::algorithm::KDTree;
+using fluid::algorithm::NeighbourIndex;
+
+static int failures = 0;
+
+void check(bool condition, const std::string& what)
+{
+  std::cout << (condition ? "ok   " : "FAIL ") << what << "\n";
+  if (!condition) failures++;
+}
+
+std::set<fluid::index> positions(const Neighbours& neighbours)
+{
+  std::set<fluid::index> result;
+  for (auto& n : neighbours) result.insert(n.second);
+  return result;
+}
+
+// fraction of the exact neighbours that the approximate search also found
+double recall(const Neighbours& exact, const Neighbours& approximate)
+{
+  if (exact.empty()) return 1;
+  auto   found = positions(approximate);
+  double hits = 0;
+  for (auto& n : exact) hits += found.count(n.second);
+  return hits / exact.size();
+}
+
+int main()
+{
+  const fluid::index nPoints = 2000, nDims = 8, nQueries = 100, k = 10;
+  const fluid::index searchWidth = 50;
+
+  std::mt19937                     rng(1);
+  std::normal_distribution<double> normal;
+  DataSet                          dataset(nDims);
+  fluid::RealVector                point(nDims);
+  for (fluid::index i = 0; i < nPoints; i++)
+  {
+    for (auto& x : point) x = normal(rng);
+    dataset.add(std::to_string(i), point);
+  }
+  std::vector<fluid::RealVector> queries;
+  for (fluid::index i = 0; i < nQueries; i++)
+  {
+    for (auto& x : point) x = normal(rng);
+    queries.push_back(point);
+  }
+
+  KDTree                    tree(dataset);
+  NeighbourIndex            graph(dataset, 1); // searchIndex = HNSW
+  NeighbourIndex::Workspace ws;
+  Neighbours                exact, approximate;
+
+  // k nearest, at the default and at a narrow search width
+  double total = 0, narrow = 0;
+  for (auto& q : queries)
+  {
+    tree.kNearest(q, k, 0, exact);
+    graph.kNearest(q, k, 0, approximate, ws, searchWidth);
+    total += recall(exact, approximate);
+    graph.kNearest(q, k, 0, approximate, ws, k);
+    narrow += recall(exact, approximate);
+  }
+  check(total / nQueries >= 0.95, "recall@10 at searchWidth 50 is " +
+                                      std::to_string(total / nQueries));
+  check(narrow / nQueries >= 0.5, "recall@10 at searchWidth 10 is " +
+                                      std::to_string(narrow / nQueries));
+
+  // radius searches (k = 0) must not stop at the search width
+  const double radius = 2.5;
+  double       radiusRecall = 0;
+  fluid::index largest = 0;
+  bool         inside = true;
+  for (auto& q : queries)
+  {
+    tree.kNearest(q, 0, radius, exact);
+    graph.kNearest(q, 0, radius, approximate, ws, searchWidth);
+    radiusRecall += recall(exact, approximate);
+    largest = std::max(largest, fluid::asSigned(approximate.size()));
+    for (auto& n : approximate) inside = inside && n.first < radius;
+  }
+  check(radiusRecall / nQueries >= 0.99,
+        "radius recall is " + std::to_string(radiusRecall / nQueries));
+  check(largest > searchWidth, "radius search returned up to " +
+                                   std::to_string(largest) + " points");
+  check(inside, "radius search only returns points within radius");
+  graph.kNearest(queries[0], 0, 0, approximate, ws, searchWidth);
+  check(fluid::asSigned(approximate.size()) == nPoints,
+        "radius 0 returns every point");
+
+  // JSON round trip gives the same answers
+  nlohmann::json j = graph;
+  check(check_json(j, NeighbourIndex()), "saved graph passes check");
+  NeighbourIndex restored = j.get<NeighbourIndex>();
+  bool           same = restored.backend() == NeighbourIndex::Backend::kHNSW;
+  NeighbourIndex::Workspace restoredWs;
+  Neighbours                again;
+  for (auto& q : queries)
+  {
+    graph.kNearest(q, k, 0, approximate, ws, searchWidth);
+    restored.kNearest(q, k, 0, again, restoredWs, searchWidth);
+    same = same && approximate == again;
+  }
+  check(same, "restored graph gives the same neighbours");
+
+  nlohmann::json bad = j;
+  bad["links"][0][0].push_back(nPoints);
+  check(!check_json(bad, NeighbourIndex()),
+        "link out of range is rejected");
+  bad = j;
+  bad["entry"] = nPoints;
+  check(!check_json(bad, NeighbourIndex()),
+        "entry point out of range is rejected");
+  bad = j;
+  bad["links"].erase(bad["links"].size() - 1);
+  check(!check_json(bad, NeighbourIndex()),
+        "missing links are rejected");
+
+  // KNN models carry the graph as their tree
+  fluid::FluidDataSet<std::string, std::string, 1> labels(1);
+  DataSet                                          targets(1);
+  for (fluid::index i = 0; i < nPoints; i++)
+  {
+    fluid::FluidTensor<std::string, 1> label{std::to_string(i % 3)};
+    fluid::RealVector                  target{double(i)};
+    labels.add(std::to_string(i), label);
+    targets.add(std::to_string(i), target);
+  }
+  nlohmann::json classifier, regressor;
+  classifier["tree"] = j;
+  classifier["labels"] = labels;
+  regressor["tree"] = j;
+  regressor["target"] = targets;
+  using fluid::client::knnclassifier::KNNClassifierData;
+  using fluid::client::knnregressor::KNNRegressorData;
+  check(check_json(classifier, KNNClassifierData()) &&
+            check_json(regressor, KNNRegressorData()),
+        "saved KNN models pass check");
+  classifier["tree"]["links"][0][0].push_back(nPoints);
+  regressor["tree"]["entry"] = nPoints;
+  check(!check_json(classifier, KNNClassifierData()),
+        "KNN classifier with a link out of range is rejected");
+  check(!check_json(regressor, KNNRegressorData()),
+        "KNN regressor with an entry point out of range is rejected");
+
+  return failures == 0 ? 0 : 1;
+}
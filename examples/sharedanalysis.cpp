@@ -0,0 +1,215 @@
+/*
+Part of the Fluid Corpus Manipulation Project (http://www.flucoma.org/)
+Copyright 2017-2019 University of Huddersfield.
+Licensed under the BSD-3 License.
+See license.md file in the project root for full license information.
+This project has received funding from the European Research Council (ERC)
+under the European Union’s Horizon 2020 research and innovation programme
+(grant agreement No 725899).
+*/
+
+/*
+This program drives MelBands clients that share an analysis by name, as a
+host that counts its DSP cycles would, and checks them against clients with
+private analyses: the bands must be identical while only one analysis runs,
+across resets, changes of FFT settings and subscribers that disagree. It exits with a non-zero status
+if any check fails
+*/
+
+#include <clients/common/FluidContext.hpp>
+#include <clients/common/FluidProfiler.hpp>
+#include <clients/common/ParameterSet.hpp>
+#include <clients/rt/MelBandsClient.hpp>
+#include <data/FluidIndex.hpp>
+#include <data/TensorTypes.hpp>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace fluid::client;
+using Params = std::remove_const_t<decltype(melbands::MelBandsParams)>;
+
+static int failures = 0;
+
+void check(bool condition, const std::string& what)
+{
+  std::cout << (condition ? "ok   " : "FAIL ") << what << "\n";
+  if (!condition) failures++;
+}
+
+// One client as a host would hold it: parameters, outputs and a context
+struct Descriptor
+{
+  Descriptor(const std::string& analysisName)
+      : params(melbands::MelBandsParams), client(setName(analysisName))
+  {
+    client.sampleRate(44100);
+    for (fluid::index i = 0; i < 120; i++) bands.emplace_back(1);
+    context.profiler(&profiler);
+    client.reset();
+  }
+
+  ParameterSet<const Params>& setName(const std::string& analysisName)
+  {
+    params.template set<melbands::kAnalysisName>(std::string(analysisName),
+                                                 nullptr);
+    return params;
+  }
+
+  void fftSettings(fluid::index window, fluid::index hop)
+  {
+    params.template set<melbands::kFFT>(FFTParams(window, hop, window),
+                                        nullptr);
+  }
+
+  void process(fluid::RealVector& block, fluid::index cycle)
+  {
+    context.hostCycle(cycle);
+    std::vector<HostVector<double>> input{block};
+    std::vector<HostVector<double>> output(bands.begin(), bands.end());
+    client.process<double>(input, output, context);
+  }
+
+  // the number of frames this client has analysed itself
+  fluid::index analyses()
+  {
+    auto stage = profiler.stage("stft");
+    return stage ? stage->calls : 0;
+  }
+
+  bool sameBands(const Descriptor& other) const
+  {
+    for (fluid::index i = 0; i < 40; i++)
+    {
+      auto u = fluid::asUnsigned(i);
+      if (bands[u](0) != other.bands[u](0)) return false;
+    }
+    return true;
+  }
+
+  ParameterSet<const Params>     params;
+  melbands::MelBandsClient       client;
+  std::vector<fluid::RealVector> bands;
+  FluidContext                   context;
+  Profiler                       profiler;
+};
+
+int main()
+{
+  const fluid::index blockSize = 256;
+
+  std::mt19937                     rng(1);
+  std::normal_distribution<double> normal;
+  fluid::RealVector                block(blockSize), other(blockSize);
+
+  Descriptor first("input"), second("input"), reference("");
+  fluid::index cycle = 0;
+  bool         same = true;
+
+  // the order subscribers run in changes from cycle to cycle
+  auto run = [&](fluid::index cycles, bool compare) {
+    for (fluid::index i = 0; i < cycles; i++, cycle++)
+    {
+      for (auto& x : block) x = normal(rng);
+      if (cycle % 3)
+      {
+        first.process(block, cycle + 1);
+        second.process(block, cycle + 1);
+      }
+      else
+      {
+        second.process(block, cycle + 1);
+        first.process(block, cycle + 1);
+      }
+      reference.process(block, cycle + 1);
+      if (compare)
+        same = same && first.sameBands(reference) &&
+               second.sameBands(reference);
+    }
+  };
+
+  run(200, true);
+  check(same, "shared bands match a private analysis");
+  check(first.analyses() + second.analyses() == reference.analyses(),
+        "one analysis runs for two subscribers");
+
+  // a reset of both subscribers restarts the shared analysis once
+  first.client.reset();
+  second.client.reset();
+  reference.client.reset();
+  same = true;
+  run(100, true);
+  check(same, "shared bands match after a reset");
+
+  // new FFT settings: for a cycle after the change the old settings were
+  // still in use, so the subscribers analyse privately; then the shared
+  // analysis retunes and they share again once it has filled
+  const fluid::index framesPerCycle = blockSize / 128;
+  for (Descriptor* d : {&first, &second, &reference}) d->fftSettings(512, 128);
+  fluid::index before = first.analyses() + second.analyses();
+  run(1, false);
+  fluid::index privately = first.analyses() + second.analyses() - before;
+  run(10, false);
+  fluid::index shared =
+      first.analyses() + second.analyses() - before - privately;
+  same = true;
+  run(100, true);
+  check(same, "shared bands match after new FFT settings");
+  check(privately == 2 * framesPerCycle && shared == 10 * framesPerCycle,
+        "the shared analysis retunes after an unused cycle");
+
+  // subscribers that disagree on settings, or join late with a reset, don't
+  // disturb it: they analyse privately and the others keep sharing
+  Descriptor disagreeing("input"), disagreeingReference("");
+  disagreeing.fftSettings(1024, 256);
+  disagreeingReference.fftSettings(1024, 256);
+  bool disagreeingSame = true;
+  before = first.analyses() + second.analyses();
+  for (fluid::index i = 0; i < 100; i++, cycle++)
+  {
+    for (auto& x : block) x = normal(rng);
+    for (Descriptor* d :
+         {&first, &disagreeing, &second, &reference, &disagreeingReference})
+      d->process(block, cycle + 1);
+    if (i > 10)
+      disagreeingSame = disagreeingSame &&
+                        disagreeing.sameBands(disagreeingReference) &&
+                        first.sameBands(reference);
+  }
+  check(disagreeingSame &&
+            first.analyses() + second.analyses() - before ==
+                100 * framesPerCycle,
+        "subscribers with other settings analyse privately");
+
+  // later subscribers in a cycle get the first one's frames, whatever their
+  // own input
+  before = first.analyses() + second.analyses();
+  for (fluid::index i = 0; i < 10; i++, cycle++)
+  {
+    for (auto& x : block) x = normal(rng);
+    for (auto& x : other) x = normal(rng);
+    first.process(block, cycle + 1);
+    second.process(other, cycle + 1);
+    reference.process(block, cycle + 1);
+  }
+  check(second.sameBands(reference) &&
+            first.analyses() + second.analyses() - before ==
+                10 * framesPerCycle,
+        "later subscribers are given the first subscriber's frames");
+
+  // without a cycle count nothing is shared
+  Descriptor uncounted("input"), uncountedToo("input");
+  for (fluid::index i = 0; i < 20; i++)
+  {
+    for (auto& x : block) x = normal(rng);
+    uncounted.process(block, 0);
+    uncountedToo.process(block, 0);
+  }
+  check(uncounted.analyses() == uncountedToo.analyses() &&
+            uncounted.analyses() > 0,
+        "without a host cycle count each client analyses its own input");
+
+  return failures == 0 ? 0 : 1;
+}
@@ -11,13 +11,17 @@ under the European Union’s Horizon 2020 research and innovation programme
 #pragma once
 
 #include "../util/FluidEigenMappings.hpp"
+#include "../util/ParallelFor.hpp"
 #include "../../data/FluidDataSet.hpp"
 #include "../../data/FluidIndex.hpp"
 #include "../../data/FluidTensor.hpp"
 #include "../../data/TensorTypes.hpp"
 #include <Eigen/Core>
+#include <algorithm>
 #include <set>
 #include <string>
+#include <utility>
+#include <vector>
 
 namespace fluid {
 namespace algorithm {
@@ -83,37 +87,44 @@ public:
     return true;
   }
 
+  // Conditions are evaluated a column at a time into a row mask, then the
+  // selected rows and columns are gathered into the output in one pass
   void process(const DataSet& input, DataSet& current, DataSet& output)
   {
-    auto data = input.getData();
-    auto ids = input.getIds();
-    mTmpPoint = RealVector(asUnsigned(current.pointSize()) + mColumns.size());
-    index limit = mLimit == 0 ? input.size() : mLimit;
-    index count = 0;
-    for (index i = 0; i < input.size() && count < limit; i++)
+    using namespace _impl;
+    auto  data = asEigen<Eigen::Array>(input.getData());
+    index n = input.size();
+
+    // Blocks of rows keep the column passes in cache and let a limit stop the
+    // scan early. The limit counts matching rows before any join with current
+    index limit = mLimit == 0 ? n : mLimit;
+    mRows.clear();
+    for (index start = 0; start < n && asSigned(mRows.size()) < limit;
+         start += kBlockSize)
     {
-      bool matchesAllAnd = true;
-      auto point = data.row(i);
-      for (index j = 0; j < asSigned(mAndConditions.size()); j++)
-        if (!mAndConditions[asUnsigned(j)].test(point)) matchesAllAnd = false;
-      if (matchesAllAnd)
-      {
-        addRow(ids(i), point, current, output);
-        count++;
-        continue;
-      }
-      else
+      index size = std::min(kBlockSize, n - start);
+      auto  block = data.middleRows(start, size);
+
+      // no AND conditions means every row matches, whatever the OR conditions
+      mMask.setConstant(size, true);
+      for (auto& c : mAndConditions)
+        compare(c, block.col(c.column),
+                [this](auto&& m) { mMask = mMask && m; });
+      if (!mAndConditions.empty() && !mOrConditions.empty())
       {
-        bool matchesAnyOr = false;
-        for (index k = 0; k < asSigned(mOrConditions.size()); k++)
-          if (mOrConditions[asUnsigned(k)].test(point)) matchesAnyOr = true;
-        if (matchesAnyOr)
-        {
-          addRow(ids(i), point, current, output);
-          count++;
-        }
+        mOrMask.setConstant(size, false);
+        for (auto& c : mOrConditions)
+          compare(c, block.col(c.column),
+                  [this](auto&& m) { mOrMask = mOrMask || m; });
+        mMask = mMask || mOrMask;
       }
+
+      for (index i = 0; i < size && asSigned(mRows.size()) < limit; i++)
+        if (mMask(i)) mRows.push_back(start + i);
     }
+
+    if (current.pointSize() > 0) join(input, current);
+    gather(input, current, output);
   }
 
   void print() const {}
@@ -128,27 +139,132 @@ public:
   }
 
 private:
-  void addRow(string id, RealVectorView point, const DataSet& current,
-              DataSet& out)
+  using ArrayXb = Eigen::Array<bool, Eigen::Dynamic, 1>;
+
+  // Dispatches on the comparison once per condition, handing the whole
+  // column's result to combine
+  template <typename Column, typename Combine>
+  static void compare(const Condition& c, const Column& column,
+                      Combine&& combine)
   {
-    mTmpPoint.fill(0);
-    index currentSize = current.pointSize();
-    bool  shouldAdd = true;
-    if (currentSize > 0)
+    switch (c.comparison)
+    {
+    case 0: combine(column == c.value); break;
+    case 1: combine(column != c.value); break;
+    case 2: combine(column < c.value); break;
+    case 3: combine(column <= c.value); break;
+    case 4: combine(column > c.value); break;
+    case 5: combine(column >= c.value); break;
+    }
+  }
+
+  // Hash join of the selected rows with current on id. Both datasets already
+  // keep an id index, so the smaller side is scanned and the larger one
+  // probed; the probes are read-only and split over threads. Keeps the
+  // selected rows that have a match, in input order
+  void join(const DataSet& input, const DataSet& current)
+  {
+    index numRows = asSigned(mRows.size());
+    auto  inputIds = input.getIds();
+    mCurrentRows.assign(asUnsigned(numRows), -1);
+    if (numRows <= current.size())
+    {
+      index workers = numWorkers(numRows, kMinRowsPerWorker);
+      parallelFor(numRows, workers, [&](index begin, index end, index) {
+        for (index i = begin; i < end; i++)
+          mCurrentRows[asUnsigned(i)] =
+              current.getIndex(inputIds(mRows[asUnsigned(i)]));
+      });
+    }
+    else
     {
-      RealVectorView currentData = mTmpPoint(Slice(0, currentSize));
-      shouldAdd = current.get(id, currentData);
+      // position of each input row in the selection, or -1
+      mSelection.assign(asUnsigned(input.size()), -1);
+      for (index i = 0; i < numRows; i++)
+        mSelection[asUnsigned(mRows[asUnsigned(i)])] = i;
+      auto  currentIds = current.getIds();
+      index workers = numWorkers(current.size(), kMinRowsPerWorker);
+      parallelFor(current.size(), workers, [&](index begin, index end, index) {
+        for (index j = begin; j < end; j++)
+        {
+          index r = input.getIndex(currentIds(j));
+          if (r < 0) continue;
+          index i = mSelection[asUnsigned(r)];
+          // ids are unique on both sides, so no two probes write the same slot
+          if (i >= 0) mCurrentRows[asUnsigned(i)] = j;
+        }
+      });
     }
-    if (shouldAdd)
+
+    index kept = 0;
+    for (index i = 0; i < numRows; i++)
     {
-      for (auto c : mColumns) mTmpPoint(currentSize++) = point(c);
-      out.add(id, mTmpPoint);
+      if (mCurrentRows[asUnsigned(i)] < 0) continue;
+      mRows[asUnsigned(kept)] = mRows[asUnsigned(i)];
+      mCurrentRows[asUnsigned(kept++)] = mCurrentRows[asUnsigned(i)];
     }
+    mRows.resize(asUnsigned(kept));
+    mCurrentRows.resize(asUnsigned(kept));
   }
 
+  // Copies the selected rows into a pre-sized matrix, current's columns first,
+  // taking each run of consecutive selected columns as one segment
+  void gather(const DataSet& input, const DataSet& current, DataSet& output)
+  {
+    using namespace _impl;
+    index currentSize = current.pointSize();
+    index numRows = asSigned(mRows.size());
+
+    mRuns.clear();
+    for (auto c : mColumns)
+    {
+      if (!mRuns.empty() && mRuns.back().first + mRuns.back().second == c)
+        mRuns.back().second++;
+      else
+        mRuns.emplace_back(c, 1);
+    }
+
+    RealMatrix             points(numRows, currentSize + numColumns());
+    FluidTensor<string, 1> ids(numRows);
+    auto                   src = asEigen<Eigen::Array>(input.getData());
+    auto                   dst = asEigen<Eigen::Array>(points);
+    auto                   inputIds = input.getIds();
+    auto                   joined = asEigen<Eigen::Array>(current.getData());
+    index                  workers = numWorkers(numRows, kMinRowsPerWorker);
+    parallelFor(numRows, workers, [&](index begin, index end, index) {
+      for (index i = begin; i < end; i++)
+      {
+        index r = mRows[asUnsigned(i)];
+        ids(i) = inputIds(r);
+        index col = 0;
+        if (currentSize > 0)
+        {
+          dst.row(i).head(currentSize) =
+              joined.row(mCurrentRows[asUnsigned(i)]);
+          col = currentSize;
+        }
+        for (auto& run : mRuns)
+        {
+          dst.row(i).segment(col, run.second) =
+              src.row(r).segment(run.first, run.second);
+          col += run.second;
+        }
+      }
+    });
+    output = DataSet(std::move(ids), std::move(points));
+  }
+
+  static constexpr index kBlockSize = 4096;
+  static constexpr index kMinRowsPerWorker = 1 << 15;
+
   index                    mLimit{0};
   std::set<index>          mColumns;
-  RealVector               mTmpPoint;
+  ArrayXb                  mMask;
+  ArrayXb                  mOrMask;
+  std::vector<index>       mRows;
+  std::vector<index>       mCurrentRows;
+  std::vector<index>       mSelection;
+  std::vector<std::pair<index, index>> mRuns;
   std::vector<std::string> mComparisons;
   std::vector<Condition>   mAndConditions;
   std::vector<Condition>   mOrConditions;
@@ -0,0 +1,402 @@
+/*
+Part of the Fluid Corpus Manipulation Project (http://www.flucoma.org/)
+Copyright 2017-2019 University of Huddersfield.
+Licensed under the BSD-3 License.
+See license.md file in the project root for full license information.
+This project has received funding from the European Research Council (ERC)
+under the European Union’s Horizon 2020 research and innovation programme
+(grant agreement No 725899).
+*/
+
+#pragma once
+
+#include "../util/FluidEigenMappings.hpp"
+#include "../util/VectorKernels.hpp"
+#include "../../data/FluidDataSet.hpp"
+#include "../../data/FluidIndex.hpp"
+#include "../../data/FluidTensor.hpp"
+#include "../../data/TensorTypes.hpp"
+#include <Eigen/Core>
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace fluid {
+namespace algorithm {
+
+// Hierarchical navigable small world graph (Malkov & Yashunin 2016), for
+// approximate nearest neighbours under Euclidean distance. Each point joins
+// the layers up to a random level, linked to up to mMaxLinks neighbours per
+// layer (twice that on the bottom one); queries descend greedily from the top
+// layer and then run a beam search of width ef on the bottom layer, so ef
+// trades recall for speed
+class HNSW
+{
+public:
+  using string = std::string;
+  using DataSet = FluidDataSet<string, double, 1>;
+  using ConstRealVectorView = FluidTensorView<const double, 1>;
+  using RowMatrixXd =
+      Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+  // (distance, position), where position is the point's row in the dataset
+  using Neighbour = std::pair<double, index>;
+  // links[position][layer] lists a point's neighbours on each of its layers
+  using Links = std::vector<std::vector<std::vector<index>>>;
+
+  static constexpr index kDefaultMaxLinks = 16;
+  static constexpr index kDefaultBuildWidth = 200;
+
+  // Per-caller search state, so that const queries can run concurrently and
+  // repeated ones need not allocate
+  struct Workspace
+  {
+    std::vector<unsigned>  visited;
+    unsigned               epoch{0};
+    std::vector<Neighbour> candidates;
+    std::vector<Neighbour> results;
+  };
+
+  explicit HNSW() = default;
+
+  HNSW(const DataSet& dataset, index maxLinks = kDefaultMaxLinks,
+       index buildWidth = kDefaultBuildWidth)
+      : mIds(dataset.getIds()), mMaxLinks(std::max<index>(2, maxLinks)),
+        mBuildWidth(std::max(buildWidth, mMaxLinks))
+  {
+    mData = _impl::asEigen<Eigen::Matrix>(dataset.getData());
+    index n = mData.rows();
+    mLinks.assign(asUnsigned(n), {});
+    std::mt19937                           engine(kSeed);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    double levelScale = 1.0 / std::log(static_cast<double>(mMaxLinks));
+    for (index i = 0; i < n; i++)
+    {
+      index level = static_cast<index>(
+          std::floor(-std::log(1.0 - uniform(engine)) * levelScale));
+      insert(i, level);
+    }
+    mInitialized = true;
+  }
+
+  // Fills neighbours with up to k (distance, position) pairs, nearest first,
+  // searching with beam width max(k, ef). With k = 0 there is no cap: the
+  // search keeps spreading from the beam's results through every point within
+  // radius, and a radius of 0 returns all points
+  void kNearest(ConstRealVectorView data, index k, double radius,
+                std::vector<Neighbour>& neighbours, Workspace& ws,
+                index ef = 50) const
+  {
+    assert(data.size() == dims());
+    neighbours.clear();
+    if (size() == 0) return;
+    Eigen::Map<const Eigen::VectorXd> query(data.data(), dims());
+    if (k == 0)
+    {
+      withinRadius(query, radius, ef, neighbours, ws);
+      return;
+    }
+    index entry = descend(query, 0);
+    index width = std::max(k, ef);
+    searchLayer(query, entry, width, 0, ws);
+    std::sort_heap(ws.results.begin(), ws.results.end());
+    double squaredRadius = radius * radius;
+    for (auto& r : ws.results)
+    {
+      if (k > 0 && asSigned(neighbours.size()) >= k) break;
+      if (radius > 0 && r.first >= squaredRadius) break;
+      neighbours.emplace_back(std::sqrt(r.first), r.second);
+    }
+  }
+
+  DataSet kNearest(ConstRealVectorView data, index k = 1, double radius = 0,
+                   index ef = 50) const
+  {
+    Workspace              ws;
+    std::vector<Neighbour> neighbours;
+    kNearest(data, k, radius, neighbours, ws, ef);
+    DataSet result(1);
+    for (auto& neighbour : neighbours)
+    {
+      auto dist = FluidTensor<double, 1>{neighbour.first};
+      result.add(mIds(neighbour.second), dist);
+    }
+    return result;
+  }
+
+  index dims() const { return mData.cols(); }
+  index size() const { return mData.rows(); }
+  bool  initialized() const { return mInitialized; }
+  FluidTensorView<const string, 1> ids() const { return mIds; }
+
+  void clear()
+  {
+    mData.resize(0, 0);
+    mIds = FluidTensor<string, 1>();
+    mLinks.clear();
+    mEntry = -1;
+    mTopLevel = -1;
+    mInitialized = false;
+  }
+
+  // Serialisation support
+  RealMatrix getData() const
+  {
+    RealMatrix result(size(), dims());
+    _impl::asEigen<Eigen::Matrix>(result) = mData;
+    return result;
+  }
+  const Links& getLinks() const { return mLinks; }
+  index        maxLinks() const { return mMaxLinks; }
+  index        buildWidth() const { return mBuildWidth; }
+  index        entryPoint() const { return mEntry; }
+
+  void init(FluidTensorView<const string, 1> ids,
+            FluidTensorView<const double, 2> data, Links links, index entry,
+            index maxLinks, index buildWidth)
+  {
+    mIds = FluidTensor<string, 1>(ids);
+    mData = _impl::asEigen<Eigen::Matrix>(data);
+    mLinks = std::move(links);
+    mEntry = entry;
+    mTopLevel = entry < 0 ? -1 : topLevel(entry);
+    mMaxLinks = maxLinks;
+    mBuildWidth = buildWidth;
+    mInitialized = true;
+  }
+
+private:
+  template <typename Vector>
+  double distance(const Vector& query, index position) const
+  {
+    return kernels::squaredDistance(mData.row(position).data(), query.data(),
+                                    dims());
+  }
+
+  index topLevel(index position) const
+  {
+    return asSigned(mLinks[asUnsigned(position)].size()) - 1;
+  }
+
+  index maxLinks(index level) const
+  {
+    return level == 0 ? 2 * mMaxLinks : mMaxLinks;
+  }
+
+  // Greedy walk from the entry point down to (but not into) the given layer
+  template <typename Vector>
+  index descend(const Vector& query, index level) const
+  {
+    index  current = mEntry;
+    double currentDist = distance(query, current);
+    for (index l = mTopLevel; l > level; l--)
+    {
+      bool changed = true;
+      while (changed)
+      {
+        changed = false;
+        for (index next : mLinks[asUnsigned(current)][asUnsigned(l)])
+        {
+          double d = distance(query, next);
+          if (d < currentDist)
+          {
+            currentDist = d;
+            current = next;
+            changed = true;
+          }
+        }
+      }
+    }
+    return current;
+  }
+
+  // Starts a fresh set of visited marks
+  void nextEpoch(Workspace& ws) const
+  {
+    if (ws.visited.size() < mLinks.size())
+    {
+      ws.visited.assign(mLinks.size(), 0);
+      ws.epoch = 0;
+    }
+    if (++ws.epoch == 0)
+    {
+      std::fill(ws.visited.begin(), ws.visited.end(), 0);
+      ws.epoch = 1;
+    }
+  }
+
+  // Radius search: the beam's results within radius, then anything linked to
+  // those on the bottom layer that is also within it, and so on
+  template <typename Vector>
+  void withinRadius(const Vector& query, double radius, index ef,
+                    std::vector<Neighbour>& neighbours, Workspace& ws) const
+  {
+    if (radius <= 0)
+    {
+      for (index i = 0; i < size(); i++)
+        neighbours.emplace_back(distance(query, i), i);
+    }
+    else
+    {
+      double squaredRadius = radius * radius;
+      searchLayer(query, descend(query, 0), ef, 0, ws);
+      nextEpoch(ws);
+      for (auto& r : ws.results)
+      {
+        ws.visited[asUnsigned(r.second)] = ws.epoch;
+        if (r.first < squaredRadius) neighbours.push_back(r);
+      }
+      for (index i = 0; i < asSigned(neighbours.size()); i++)
+      {
+        index current = neighbours[asUnsigned(i)].second;
+        for (index next : mLinks[asUnsigned(current)][0])
+        {
+          if (ws.visited[asUnsigned(next)] == ws.epoch) continue;
+          ws.visited[asUnsigned(next)] = ws.epoch;
+          double d = distance(query, next);
+          if (d < squaredRadius) neighbours.emplace_back(d, next);
+        }
+      }
+    }
+    std::sort(neighbours.begin(), neighbours.end());
+    for (auto& n : neighbours) n.first = std::sqrt(n.first);
+  }
+
+  // Beam search on one layer. Leaves the (squared distance, position) of the
+  // ef nearest points found as a max-heap in ws.results
+  template <typename Vector>
+  void searchLayer(const Vector& query, index entry, index ef, index level,
+                   Workspace& ws) const
+  {
+    nextEpoch(ws);
+    auto closer = std::greater<Neighbour>();
+    ws.candidates.clear();
+    ws.results.clear();
+    double d = distance(query, entry);
+    ws.visited[asUnsigned(entry)] = ws.epoch;
+    ws.candidates.emplace_back(d, entry);
+    ws.results.emplace_back(d, entry);
+
+    while (!ws.candidates.empty())
+    {
+      std::pop_heap(ws.candidates.begin(), ws.candidates.end(), closer);
+      Neighbour current = ws.candidates.back();
+      ws.candidates.pop_back();
+      if (current.first > ws.results.front().first) break;
+      for (index next : mLinks[asUnsigned(current.second)][asUnsigned(level)])
+      {
+        if (ws.visited[asUnsigned(next)] == ws.epoch) continue;
+        ws.visited[asUnsigned(next)] = ws.epoch;
+        double dNext = distance(query, next);
+        bool full = asSigned(ws.results.size()) >= ef;
+        if (!full || dNext < ws.results.front().first)
+        {
+          ws.candidates.emplace_back(dNext, next);
+          std::push_heap(ws.candidates.begin(), ws.candidates.end(), closer);
+          ws.results.emplace_back(dNext, next);
+          std::push_heap(ws.results.begin(), ws.results.end());
+          if (asSigned(ws.results.size()) > ef)
+          {
+            std::pop_heap(ws.results.begin(), ws.results.end());
+            ws.results.pop_back();
+          }
+        }
+      }
+    }
+  }
+
+  // The neighbour selection heuristic: take candidates nearest first,
+  // skipping any closer to an already chosen neighbour than to the point, so
+  // that links spread in different directions; then top up with the skipped
+  // ones. candidates must be sorted by distance
+  void selectNeighbours(std::vector<Neighbour>& candidates, index count,
+                        std::vector<index>& out)
+  {
+    out.clear();
+    mSkipped.clear();
+    for (auto& c : candidates)
+    {
+      if (asSigned(out.size()) >= count) break;
+      bool keep = true;
+      for (index chosen : out)
+      {
+        if (distance(mData.row(chosen).transpose(), c.second) < c.first)
+        {
+          keep = false;
+          break;
+        }
+      }
+      if (keep)
+        out.push_back(c.second);
+      else
+        mSkipped.push_back(c.second);
+    }
+    for (index skipped : mSkipped)
+    {
+      if (asSigned(out.size()) >= count) break;
+      out.push_back(skipped);
+    }
+  }
+
+  void insert(index position, index level)
+  {
+    auto& links = mLinks[asUnsigned(position)];
+    links.assign(asUnsigned(level + 1), {});
+    if (mEntry < 0)
+    {
+      mEntry = position;
+      mTopLevel = level;
+      return;
+    }
+    auto  query = mData.row(position).transpose();
+    index entry = descend(query, level);
+    for (index l = std::min(level, mTopLevel); l >= 0; l--)
+    {
+      searchLayer(query, entry, mBuildWidth, l, mWorkspace);
+      mCandidates = mWorkspace.results;
+      std::sort(mCandidates.begin(), mCandidates.end());
+      entry = mCandidates.front().second;
+      selectNeighbours(mCandidates, mMaxLinks, links[asUnsigned(l)]);
+
+      // link back, pruning any neighbour that now has too many links
+      for (index other : links[asUnsigned(l)])
+      {
+        auto& otherLinks = mLinks[asUnsigned(other)][asUnsigned(l)];
+        otherLinks.push_back(position);
+        if (asSigned(otherLinks.size()) <= maxLinks(l)) continue;
+        auto otherPoint = mData.row(other).transpose();
+        mCandidates.clear();
+        for (index o : otherLinks)
+          mCandidates.emplace_back(distance(otherPoint, o), o);
+        std::sort(mCandidates.begin(), mCandidates.end());
+        selectNeighbours(mCandidates, maxLinks(l), otherLinks);
+      }
+    }
+    if (level > mTopLevel)
+    {
+      mEntry = position;
+      mTopLevel = level;
+    }
+  }
+
+  static constexpr unsigned kSeed = 42;
+
+  RowMatrixXd            mData;
+  FluidTensor<string, 1> mIds;
+  Links                  mLinks;
+  index                  mEntry{-1};
+  index                  mTopLevel{-1};
+  index                  mMaxLinks{kDefaultMaxLinks};
+  index                  mBuildWidth{kDefaultBuildWidth};
+  bool                   mInitialized{false};
+
+  // build scratch
+  Workspace              mWorkspace;
+  std::vector<Neighbour> mCandidates;
+  std::vector<index>     mSkipped;
+};
+} // namespace algorithm
+} // namespace fluid
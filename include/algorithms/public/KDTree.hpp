@@ -11,14 +11,18 @@ under the European Union’s Horizon 2020 research and innovation programme
 #pragma once
 
 #include "../util/FluidEigenMappings.hpp"
+#include "../util/VectorKernels.hpp"
 #include "../../data/FluidDataSet.hpp"
 #include "../../data/FluidIndex.hpp"
 #include "../../data/FluidTensor.hpp"
 #include "../../data/TensorTypes.hpp"
 #include <Eigen/Core>
+#include <algorithm>
+#include <cmath>
 #include <queue>
 #include <memory>
 #include <string>
+#include <vector>
 
 namespace fluid {
 namespace algorithm {
@@ -34,15 +38,20 @@ public:
   struct Node;
   using NodePtr = std::shared_ptr<Node>;
   using knnCandidate = std::pair<double, const Node*>;
+  // (distance, Node::position)
+  using Neighbour = std::pair<double, index>;
   using knnQueue = std::priority_queue<knnCandidate, std::vector<knnCandidate>,
                                        std::less<knnCandidate>>;
   using iterator = const std::vector<index>::iterator;
 
+  // position numbers the points 0 to size() - 1: the dataset row for a
+  // built tree, the flat index for one restored by fromFlat()
   struct Node
   {
     const string     id;
     const RealVector data;
     NodePtr          left{nullptr}, right{nullptr};
+    const index      position;
   };
 
   struct FlatData
@@ -72,33 +81,45 @@ public:
 
   void addNode(string id, ConstRealVectorView data)
   {
-    mRoot = addNode(mRoot.get(), id, data, 0);
+    mRoot = addNode(mRoot.get(), id, data, 0, mNPoints);
     mNPoints++;
   }
 
   DataSet kNearest(ConstRealVectorView data, index k = 1,
                    double radius = 0) const
   {
-    assert(data.size() == mDims);
-    knnQueue queue;
-    auto     result = DataSet(1);
-    kNearest(mRoot.get(), data, queue, k, radius, 0);
-    index                     numFound = asSigned(queue.size());
-    std::vector<knnCandidate> sorted(asUnsigned(numFound));
-    for (index i = numFound - 1; i >= 0; i--)
-    {
-      sorted[asUnsigned(i)] = queue.top();
-      queue.pop();
-    }
-    for (index i = 0; i < numFound; i++)
+    std::vector<knnCandidate> sorted;
+    kNearest(data, k, radius, sorted);
+    auto result = DataSet(1);
+    for (auto& neighbour : sorted)
     {
-      auto dist = FluidTensor<double, 1>{sorted[asUnsigned(i)].first};
-      auto id = sorted[asUnsigned(i)].second->id;
-      result.add(id, dist);
+      auto dist = FluidTensor<double, 1>{neighbour.first};
+      result.add(neighbour.second->id, dist);
     }
     return result;
   }
 
+  // Fills neighbours with (distance, node) or (distance, position) pairs,
+  // nearest first. The vector is reused as the search heap, so repeated
+  // queries need not allocate
+  template <typename Candidate>
+  void kNearest(ConstRealVectorView data, index k, double radius,
+                std::vector<Candidate>& neighbours) const
+  {
+    assert(data.size() == mDims);
+    neighbours.clear();
+    kNearest(mRoot.get(), data, neighbours, k, radius, 0);
+    std::sort_heap(neighbours.begin(), neighbours.end());
+  }
+
+  // The ids of all points, indexed by Node::position
+  FluidTensor<string, 1> ids() const
+  {
+    FluidTensor<string, 1> result(mNPoints);
+    collectIds(mRoot.get(), result);
+    return result;
+  }
+
   void  print() const { print(mRoot.get(), 0); }
   index dims() const { return mDims; }
   index size() const { return mNPoints; }
@@ -134,7 +155,8 @@ private:
       return nullptr;
     else if (std::distance(from, to) == 1)
     {
-      return makeNode(dataset.getIds()(*from), dataset.getData().row(*from));
+      return makeNode(dataset.getIds()(*from), dataset.getData().row(*from),
+                      *from);
     }
     const index d = depth % mDims;
     sort(from, to, [&](index a, index b) {
@@ -143,7 +165,8 @@ private:
     const index range = std::distance(from, to);
     const index median = range / 2;
     NodePtr     current = makeNode(dataset.getIds().row(*(from + median)),
-                               dataset.getData().row(*(from + median)));
+                               dataset.getData().row(*(from + median)),
+                               *(from + median));
     if (median > 0)
       current->left =
           buildTree(indices, from, from + median, dataset, depth + 1);
@@ -153,28 +176,36 @@ private:
     return current;
   }
 
-  NodePtr makeNode(string id, ConstRealVectorView data) const
+  NodePtr makeNode(string id, ConstRealVectorView data, index position) const
   {
-    return std::make_shared<Node>(Node{id, RealVector{data}, nullptr, nullptr});
+    return std::make_shared<Node>(
+        Node{id, RealVector{data}, nullptr, nullptr, position});
   }
 
   NodePtr addNode(Node* current, string id, ConstRealVectorView data,
-                  const index depth) const
+                  const index depth, index position) const
   {
-    if (current == nullptr) { return makeNode(id, data); }
+    if (current == nullptr) { return makeNode(id, data, position); }
 
     const index d = depth % mDims;
     if (data(d) < current->data(d))
-    { current->left = addNode(current->left.get(), id, data, depth + 1); }
+    {
+      current->left =
+          addNode(current->left.get(), id, data, depth + 1, position);
+    }
     else
     {
-      current->right = addNode(current->right.get(), id, data, depth + 1);
+      current->right =
+          addNode(current->right.get(), id, data, depth + 1, position);
     }
     return NodePtr(current);
   }
 
   double distance(ConstRealVectorView p1, ConstRealVectorView p2) const
   {
+    if (p1.descriptor().strides[0] == 1 && p2.descriptor().strides[0] == 1)
+      return std::sqrt(
+          kernels::squaredDistance(p1.data(), p2.data(), p1.size()));
     using namespace Eigen;
     auto v1 = _impl::asEigen<Array>(p1);
     auto v2 = _impl::asEigen<Array>(p2);
@@ -198,18 +229,36 @@ private:
     print(current->right.get(), depth + 1);
   }
 
-  void kNearest(const Node* current, ConstRealVectorView data, knnQueue& knn,
-                index k, double radius, index depth) const
+  static knnCandidate candidate(double dist, const Node* node, knnCandidate*)
+  {
+    return {dist, node};
+  }
+
+  static Neighbour candidate(double dist, const Node* node, Neighbour*)
+  {
+    return {dist, node->position};
+  }
+
+  // knn is a max-heap on distance (std::push_heap / pop_heap)
+  template <typename Candidate>
+  void kNearest(const Node* current, ConstRealVectorView data,
+                std::vector<Candidate>& knn, index k, double radius,
+                index depth) const
   {
     if (current == nullptr) return;
     const double currentDist = distance(current->data, data);
     bool         withinRadius = radius > 0 ? currentDist < radius : true;
+    Candidate*   tag = nullptr;
     if (withinRadius && (knn.size() < asUnsigned(k) || k == 0))
-    { knn.push(std::make_pair(currentDist, current)); }
-    else if (withinRadius && currentDist < knn.top().first)
     {
-      knn.pop();
-      knn.push(std::make_pair(currentDist, current));
+      knn.push_back(candidate(currentDist, current, tag));
+      std::push_heap(knn.begin(), knn.end());
+    }
+    else if (withinRadius && currentDist < knn.front().first)
+    {
+      std::pop_heap(knn.begin(), knn.end());
+      knn.back() = candidate(currentDist, current, tag);
+      std::push_heap(knn.begin(), knn.end());
     }
     const index  d = depth % mDims;
     const double dimDif = current->data(d) - data(d);
@@ -222,12 +271,20 @@ private:
     }
     kNearest(firstBranch, data, knn, k, radius, depth + 1);
     if (k == 0 || knn.size() < asUnsigned(k) ||
-        dimDif < knn.top().first) // ball centered at query with diametre
+        dimDif < knn.front().first) // ball centered at query with diametre
                                   // kthDist intersects with current partition
                                   // (or need to get more neighbors)
     { kNearest(secondBranch, data, knn, k, radius, depth + 1); }
   }
 
+  void collectIds(const Node* current, FluidTensorView<string, 1> out) const
+  {
+    if (current == nullptr) return;
+    out(current->position) = current->id;
+    collectIds(current->left.get(), out);
+    collectIds(current->right.get(), out);
+  }
+
   index flatten(index nodeId, const Node* current, FlatData& store) const
   {
     if (current == nullptr) { return nodeId; }
@@ -253,7 +310,7 @@ private:
   NodePtr unflatten(const FlatData& store, index index) const
   {
     if (index == -1) return nullptr;
-    NodePtr current = makeNode(store.ids[index], store.data[index]);
+    NodePtr current = makeNode(store.ids[index], store.data[index], index);
     current->left = unflatten(store, store.tree(index, 0));
     current->right = unflatten(store, store.tree(index, 1));
     return current;
@@ -10,14 +10,17 @@ under the European Union’s Horizon 2020 research and innovation programme
 
 #pragma once
 
-#include "KDTree.hpp"
+#include "NeighbourIndex.hpp"
 #include "../util/AlgorithmUtils.hpp"
 #include "../util/FluidEigenMappings.hpp"
+#include "../util/ParallelFor.hpp"
 #include "../../data/FluidDataSet.hpp"
 #include "../../data/FluidIndex.hpp"
 #include "../../data/FluidTensor.hpp"
 #include "../../data/TensorTypes.hpp"
+#include <Eigen/Core>
 #include <string>
+#include <vector>
 
 namespace fluid {
 namespace algorithm {
@@ -28,63 +31,103 @@ class KNNClassifier
 public:
   using LabelSet = FluidDataSet<std::string, std::string, 1>;
 
-  std::string predict(KDTree tree, RealVectorView point, LabelSet labels,
-                      index k, bool weighted) const
+  // Votes over interned labels: labelCodes(p) is the code of the label of the
+  // point at position p of the index, as from LabelSetEncoder::encodeIds().
+  // Returns the winning code, or -1 if no neighbour has a label. The model
+  // is only read, and scratch storage is kept between calls, so only the
+  // first few allocate
+  index predict(const NeighbourIndex& tree, RealVectorView point,
+                FluidTensorView<const index, 1> labelCodes, index numLabels,
+                index k, bool weighted)
   {
-    using namespace std;
-    unordered_map<string, double> labelsMap;
-    auto                          nearest = tree.kNearest(point, k);
-    auto                          ids = nearest.getIds();
-    auto                          distances = nearest.getData();
+    return predict(tree, point, labelCodes, numLabels, k, weighted,
+                   mWorkspace);
+  }
+
+  // Beam width for approximate (HNSW) searches
+  void setSearchWidth(index width) { mSearchWidth = width; }
+
+  // One predicted code per row of points, spread over threads
+  void predict(const NeighbourIndex& tree, RealMatrixView points,
+               FluidTensorView<const index, 1> labelCodes, index numLabels,
+               FluidTensorView<index, 1> out, index k, bool weighted)
+  {
+    index n = points.rows();
+    index workers = numWorkers(n, kMinPointsPerWorker);
+    mWorkspaces.resize(asUnsigned(workers));
+    parallelFor(n, workers, [&](index begin, index end, index worker) {
+      Workspace& ws = mWorkspaces[asUnsigned(worker)];
+      for (index i = begin; i < end; i++)
+        out(i) = predict(tree, points.row(i), labelCodes, numLabels, k,
+                         weighted, ws);
+    });
+  }
+
+private:
+  struct Workspace
+  {
+    std::vector<NeighbourIndex::Neighbour> neighbours;
+    NeighbourIndex::Workspace              search;
+    Eigen::ArrayXd                         weights;
+    Eigen::ArrayXd                         votes;
+  };
+
+  index predict(const NeighbourIndex& tree, RealVectorView point,
+                FluidTensorView<const index, 1> labelCodes, index numLabels,
+                index k, bool weighted, Workspace& ws) const
+  {
+    tree.kNearest(point, k, 0, ws.neighbours, ws.search, mSearchWidth);
+    index numFound = asSigned(ws.neighbours.size());
 
-    double              uniformWeight = 1.0 / k;
-    std::vector<double> weights;
-    double              sum = 0;
+    ws.weights.setConstant(numFound, 1.0 / k);
     if (weighted)
     {
-      weights = std::vector<double>(asUnsigned(k), 0);
-      bool binaryWeights = false;
-      for (index i = 0; i < k; i++)
+      double sum = 0;
+      bool   binaryWeights = false;
+      for (index i = 0; i < numFound; i++)
       {
-        if (distances(i, 0) < epsilon)
+        double distance = ws.neighbours[asUnsigned(i)].first;
+        if (distance < epsilon)
         {
           binaryWeights = true;
-          weights[asUnsigned(i)] = 1;
+          ws.weights(i) = 1;
         }
         else
-          sum += (1.0 / distances(i, 0));
+        {
+          sum += (1.0 / distance);
+          ws.weights(i) = 0;
+        }
       }
       if (!binaryWeights)
       {
-        for (index i = 0; i < k; i++)
-        { weights[asUnsigned(i)] = (1.0 / distances(i, 0)) / sum; }
+        for (index i = 0; i < numFound; i++)
+          ws.weights(i) = (1.0 / ws.neighbours[asUnsigned(i)].first) / sum;
       }
     }
-    else
-    {
-      weights = std::vector<double>(asUnsigned(k), uniformWeight);
-    }
 
-    string                 prediction;
-    FluidTensor<string, 1> tmp(1);
-    double                 maxWeight = 0;
-    for (index i = 0; i < k; i++)
+    ws.votes.setZero(numLabels);
+    index  prediction = -1;
+    double maxWeight = 0;
+    for (index i = 0; i < numFound; i++)
     {
-      labels.get(ids(i), tmp);
-      string label = tmp(0);
-      auto   pos = labelsMap.find(label);
-      if (pos == labelsMap.end())
-        labelsMap[label] = weights[asUnsigned(i)];
-      else
-        labelsMap[label] += weights[asUnsigned(i)];
-      if (labelsMap[label] > maxWeight)
+      index label = labelCodes(ws.neighbours[asUnsigned(i)].second);
+      if (label < 0) continue;
+      ws.votes(label) += ws.weights(i);
+      if (ws.votes(label) > maxWeight)
       {
-        maxWeight = labelsMap[label];
+        maxWeight = ws.votes(label);
         prediction = label;
       }
     }
     return prediction;
   }
+
+  static constexpr index kMinPointsPerWorker = 256;
+
+  index                  mSearchWidth{NeighbourIndex::kDefaultSearchWidth};
+
+  Workspace              mWorkspace;
+  std::vector<Workspace> mWorkspaces;
 };
 } // namespace algorithm
 } // namespace fluid
@@ -10,14 +10,17 @@ under the European Union’s Horizon 2020 research and innovation programme
 
 #pragma once
 
-#include "KDTree.hpp"
+#include "NeighbourIndex.hpp"
 #include "../util/AlgorithmUtils.hpp"
 #include "../util/FluidEigenMappings.hpp"
+#include "../util/ParallelFor.hpp"
 #include "../../data/FluidDataSet.hpp"
 #include "../../data/FluidIndex.hpp"
 #include "../../data/FluidTensor.hpp"
 #include "../../data/TensorTypes.hpp"
+#include <Eigen/Core>
 #include <string>
+#include <vector>
 
 namespace fluid {
 namespace algorithm {
@@ -28,49 +31,106 @@ class KNNRegressor
 public:
   using DataSet = FluidDataSet<std::string, double, 1>;
 
-  double predict(KDTree tree, DataSet targets, RealVectorView point, index k,
-                 bool weighted) const
+  // targets(p) is the target of the point at position p of the index. The
+  // model is only read, so one fitted index and target table can serve any
+  // number of regressors
+  double predict(const NeighbourIndex&            tree,
+                 FluidTensorView<const double, 1> targets,
+                 RealVectorView point, index k, bool weighted)
   {
-    using namespace std;
-    auto                nearest = tree.kNearest(point, k);
-    double              prediction = 0;
-    auto                ids = nearest.getIds();
-    auto                distances = nearest.getData();
-    double              uniformWeight = 1.0 / k;
-    std::vector<double> weights;
-    double              sum = 0;
+    return predict(tree, targets, point, k, weighted, mWorkspace);
+  }
+
+  // One prediction per row of points, spread over threads
+  void predict(const NeighbourIndex&            tree,
+               FluidTensorView<const double, 1> targets,
+               RealMatrixView points, RealVectorView out, index k,
+               bool weighted)
+  {
+    index n = points.rows();
+    index workers = numWorkers(n, kMinPointsPerWorker);
+    mWorkspaces.resize(asUnsigned(workers));
+    parallelFor(n, workers, [&](index begin, index end, index worker) {
+      Workspace& ws = mWorkspaces[asUnsigned(worker)];
+      for (index i = begin; i < end; i++)
+        out(i) = predict(tree, targets, points.row(i), k, weighted, ws);
+    });
+  }
+
+  // Beam width for approximate (HNSW) searches
+  void setSearchWidth(index width) { mSearchWidth = width; }
+
+  // Target of each indexed point by position, from a dataset keyed by the
+  // same ids (missing ids give 0)
+  static RealVector targetTable(const NeighbourIndex& tree,
+                                const DataSet&        targets)
+  {
+    auto       ids = tree.ids();
+    auto       data = targets.getData();
+    RealVector result(ids.size());
+    for (index i = 0; i < ids.size(); i++)
+    {
+      index row = targets.getIndex(ids(i));
+      result(i) = row < 0 ? 0 : data(row, 0);
+    }
+    return result;
+  }
+
+private:
+  struct Workspace
+  {
+    std::vector<NeighbourIndex::Neighbour> neighbours;
+    NeighbourIndex::Workspace              search;
+    Eigen::ArrayXd                         weights;
+  };
+
+  double predict(const NeighbourIndex&            tree,
+                 FluidTensorView<const double, 1> targets,
+                 RealVectorView point, index k, bool weighted,
+                 Workspace& ws) const
+  {
+    tree.kNearest(point, k, 0, ws.neighbours, ws.search, mSearchWidth);
+    index numFound = asSigned(ws.neighbours.size());
+    ws.weights.setConstant(numFound, 1.0 / k);
     if (weighted)
     {
-      weights = std::vector<double>(asUnsigned(k), 0);
-      bool binaryWeights = false;
-      for (index i = 0; i < k; i++)
+      double sum = 0;
+      bool   binaryWeights = false;
+      for (index i = 0; i < numFound; i++)
       {
-        if (distances(i, 0) < epsilon)
+        double distance = ws.neighbours[asUnsigned(i)].first;
+        if (distance < epsilon)
         {
           binaryWeights = true;
-          weights[asUnsigned(i)] = 1;
+          ws.weights(i) = 1;
         }
         else
-          sum += (1.0 / distances(i, 0));
+        {
+          sum += (1.0 / distance);
+          ws.weights(i) = 0;
+        }
       }
       if (!binaryWeights)
       {
-        for (index i = 0; i < k; i++)
-        { weights[asUnsigned(i)] = (1.0 / distances(i, 0)) / sum; }
+        for (index i = 0; i < numFound; i++)
+          ws.weights(i) = (1.0 / ws.neighbours[asUnsigned(i)].first) / sum;
       }
     }
-    else
+    double prediction = 0;
+    for (index i = 0; i < numFound; i++)
     {
-      weights = std::vector<double>(asUnsigned(k), uniformWeight);
-    }
-    for (index i = 0; i < k; i++)
-    {
-      auto point = FluidTensor<double, 1>(1);
-      targets.get(ids(i), point);
-      prediction += (weights[asUnsigned(i)] * point(0));
+      index position = ws.neighbours[asUnsigned(i)].second;
+      prediction += ws.weights(i) * targets(position);
     }
     return prediction;
   }
+
+  static constexpr index kMinPointsPerWorker = 256;
+
+  index                  mSearchWidth{NeighbourIndex::kDefaultSearchWidth};
+
+  Workspace              mWorkspace;
+  std::vector<Workspace> mWorkspaces;
 };
 } // namespace algorithm
 } // namespace fluid
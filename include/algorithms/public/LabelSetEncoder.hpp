@@ -10,6 +10,7 @@ under the European Union’s Horizon 2020 research and innovation programme
 
 #pragma once
 
+#include "../../data/FluidDataSet.hpp"
 #include "../../data/FluidIndex.hpp"
 #include "../../data/FluidTensor.hpp"
 #include "../../data/TensorTypes.hpp"
@@ -28,23 +29,20 @@ class LabelSetEncoder
   using LabelSet = FluidDataSet<string, string, 1>;
 
 public:
-  void fit(LabelSet labels)
+  // Interns each distinct label as a compact code, in order of appearance
+  void fit(const LabelSet& labels)
   {
-    StringVector tmp(1);
-    auto         ids = labels.getIds();
+    auto data = labels.getData();
     for (index i = 0; i < labels.size(); i++)
     {
-      labels.get(ids(i), tmp);
-      string label = tmp(0);
-      auto   pos = mLabelsMap.find(label);
-      if (pos == mLabelsMap.end()) mLabelsMap[label] = mNumLabels++;
+      if (mLabelsMap.emplace(data(i, 0), mNumLabels).second) mNumLabels++;
     }
     mLabels = StringVector(mNumLabels);
     for (auto l : mLabelsMap) mLabels(l.second) = l.first;
     mInitialized = true;
   }
 
-  index encodeIndex(string label) const
+  index encodeIndex(const string& label) const
   {
     auto pos = mLabelsMap.find(label);
     if (pos != mLabelsMap.end())
@@ -53,9 +51,22 @@ public:
       return -1;
   }
 
+  // Writes the code of each point's label to out(i), or -1 for points
+  // missing from labels, so that later lookups need no string hashing
+  void encodeIds(const LabelSet& labels, FluidTensorView<const string, 1> ids,
+                 FluidTensorView<index, 1> out) const
+  {
+    auto data = labels.getData();
+    for (index i = 0; i < ids.size(); i++)
+    {
+      index row = labels.getIndex(ids(i));
+      out(i) = row < 0 ? -1 : encodeIndex(data(row, 0));
+    }
+  }
+
   std::string decodeIndex(index in) const
   {
-    if (in < mLabels.size())
+    if (in >= 0 && in < mLabels.size())
       return mLabels(in);
     else
       return "";
@@ -12,11 +12,19 @@ under the European Union’s Horizon 2020 research and innovation programme
 
 #include "../util/DistanceFuncs.hpp"
 #include "../util/FluidEigenMappings.hpp"
+#include "../../data/FluidIndex.hpp"
 #include "../../data/TensorTypes.hpp"
 #include <Eigen/Core>
+#include <Eigen/Eigenvalues>
 #include <Eigen/SVD>
+#include <Spectra/MatOp/DenseSymMatProd.h>
+#include <Spectra/SymEigsSolver.h>
+#include <algorithm>
 #include <cassert>
 #include <cmath>
+#include <limits>
+#include <numeric>
+#include <vector>
 
 namespace fluid {
 namespace algorithm {
@@ -26,31 +34,176 @@ class MDS
 public:
   using MatrixXd = Eigen::MatrixXd;
   using VectorXd = Eigen::VectorXd;
+  using ArrayXd = Eigen::ArrayXd;
+  using RowMatrixXd =
+      Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
 
-  void process(RealMatrixView in, RealMatrixView out, index distance, index k)
+  enum class Method { kExact, kPartial, kLandmark };
+
+  // kExact: full SVD of the double-centered distance matrix
+  // kPartial: only the k leading eigenpairs, via Spectra
+  // kLandmark: classical MDS on numLandmarks points chosen by MaxMin, with
+  // every other point placed by distance-based triangulation; O(n * m) memory
+  void process(RealMatrixView in, RealMatrixView out, index distance, index k,
+               index method = 0, index numLandmarks = 1000)
   {
-    using namespace Eigen;
     using namespace _impl;
-    auto     dist = static_cast<DistanceFuncs::Distance>(distance);
-    MatrixXd input = asEigen<Matrix>(in);
-    index    n = input.rows();
-    MatrixXd D = MatrixXd::Zero(n, n);
-    MatrixXd I = MatrixXd::Identity(n, n);
-    MatrixXd ones = MatrixXd::Ones(n, n);
+    auto dist = static_cast<DistanceFuncs::Distance>(distance);
+    mInput = asEigen<Eigen::Matrix>(in);
+    index n = mInput.rows();
+
+    switch (static_cast<Method>(method))
+    {
+    case Method::kLandmark:
+      if (numLandmarks >= k + 1 && numLandmarks < n)
+      {
+        landmark(dist, k, numLandmarks);
+        break;
+      }
+      exact(dist, k);
+      break;
+    case Method::kPartial:
+      if (!partial(dist, k)) exact(dist, k);
+      break;
+    default: exact(dist, k);
+    }
+    out = asFluid(mResult);
+  }
+
+private:
+  void exact(DistanceFuncs::Distance dist, index k)
+  {
+    using namespace Eigen;
+    centeredDistances(dist);
+    BDCSVD<MatrixXd> svd(mB, ComputeThinU);
+    ArrayXd          s = svd.singularValues().head(k);
+    mResult = svd.matrixU().leftCols(k).array().rowwise() * s.transpose();
+  }
+
+  // Leading eigenpairs by magnitude, which are the leading singular values of
+  // the (symmetric) centered matrix, so this matches exact() up to sign
+  bool partial(DistanceFuncs::Distance dist, index k)
+  {
+    using namespace Spectra;
+    index n = mInput.rows();
+    index ncv = std::min(n, std::max<index>(2 * k + 1, 20));
+    if (k >= n - 1) return false;
+    centeredDistances(dist);
+    DenseSymMatProd<double> op(mB);
+    SymEigsSolver<double, LARGEST_MAGN, DenseSymMatProd<double>> eig(&op, k,
+                                                                     ncv);
+    eig.init();
+    eig.compute(1000, 1e-10, LARGEST_MAGN);
+    if (eig.info() != SUCCESSFUL) return false;
+    ArrayXd s = eig.eigenvalues().array().abs();
+    mResult = eig.eigenvectors().leftCols(k).array().rowwise() * s.transpose();
+    return true;
+  }
+
+  void landmark(DistanceFuncs::Distance dist, index k, index m)
+  {
+    using namespace Eigen;
+    selectLandmarks(dist, m);
+
+    // squared terms of classical MDS are the raw distances, as in exact()
+    MatrixXd landmarkB(m, m);
+    for (index i = 0; i < m; i++)
+      landmarkB.row(i) = mLandmarkD.row(mLandmarks[asUnsigned(i)]);
+    VectorXd columnMean = landmarkB.colwise().mean().transpose();
+    double   grandMean = columnMean.mean();
+    VectorXd rowMean = landmarkB.rowwise().mean();
+    landmarkB.array().colwise() -= rowMean.array();
+    landmarkB.array().rowwise() -= columnMean.transpose().array();
+    landmarkB.array() += grandMean;
+    landmarkB *= -0.5;
+
+    SelfAdjointEigenSolver<MatrixXd> eig(landmarkB);
+    const VectorXd&                  values = eig.eigenvalues();
+    std::vector<index>               order(asUnsigned(m));
+    std::iota(order.begin(), order.end(), 0);
+    std::partial_sort(order.begin(), order.begin() + k, order.end(),
+                      [&values](index a, index b) {
+                        return std::abs(values(a)) > std::abs(values(b));
+                      });
+
+    // Triangulate every point as x_i = L# * (-0.5 * (d_i - mean(d))), with
+    // L# = v' / sqrt(lambda), which gives the usual (PCA-like) coordinates
+    MatrixXd projection(m, k);
+    for (index j = 0; j < k; j++)
+    {
+      index  c = order[asUnsigned(j)];
+      double magnitude = std::max(std::abs(values(c)), epsilon);
+      double sign = values(c) < 0 ? -1.0 : 1.0;
+      projection.col(j) =
+          (-0.5 * sign / std::sqrt(magnitude)) * eig.eigenvectors().col(c);
+    }
+    mLandmarkD.rowwise() -= columnMean.transpose();
+    mResult = mLandmarkD * projection;
+
+    // Landmark axes only approximate the principal axes of the whole set, so
+    // rotate onto the latter, then scale each by its eigenvalue (the squared
+    // column norm) to follow the U * lambda convention of exact()
+    mResult.rowwise() -= mResult.colwise().mean();
+    SelfAdjointEigenSolver<MatrixXd> axes(mResult.transpose() * mResult);
+    mResult = mResult * axes.eigenvectors().rowwise().reverse();
+    for (index j = 0; j < k; j++) mResult.col(j) *= mResult.col(j).norm();
+  }
+
+  // MaxMin (farthest point) selection, seeded with the first point. Fills
+  // mLandmarkD with the n x m distances from each point to each landmark
+  void selectLandmarks(DistanceFuncs::Distance dist, index m)
+  {
+    index n = mInput.rows();
+    mLandmarks.assign(asUnsigned(m), 0);
+    mLandmarkD.resize(n, m);
+    ArrayXd nearest =
+        ArrayXd::Constant(n, std::numeric_limits<double>::infinity());
+    index next = 0;
+    for (index j = 0; j < m; j++)
+    {
+      mLandmarks[asUnsigned(j)] = next;
+      auto landmarkRow = mInput.row(next).array();
+      for (index i = 0; i < n; i++)
+      {
+        double d = DistanceFuncs::distance(dist, mInput.row(i).array(),
+                                           landmarkRow);
+        mLandmarkD(i, j) = d;
+        nearest(i) = std::min(nearest(i), d);
+      }
+      nearest.maxCoeff(&next);
+    }
+  }
+
+  // -0.5 * J * D * J, from the upper triangle of D and its row means
+  // (D is symmetric, so row and column means coincide)
+  void centeredDistances(DistanceFuncs::Distance dist)
+  {
+    index n = mInput.rows();
+    mB.resize(n, n);
     for (index i = 0; i < n; i++)
     {
-      for (index j = 0; j < n; j++)
-      { D(i, j) = DistanceFuncs::map()[dist](input.row(i), input.row(j)); }
+      mB(i, i) = 0;
+      auto rowI = mInput.row(i).array();
+      for (index j = i + 1; j < n; j++)
+      {
+        double d = DistanceFuncs::distance(dist, rowI, mInput.row(j).array());
+        mB(i, j) = d;
+        mB(j, i) = d;
+      }
     }
-    MatrixXd J = I - ones / n;
-    D = -0.5 * J * D * J;
-    BDCSVD<MatrixXd> svd(D, ComputeThinV | ComputeThinU);
-    MatrixXd         U = svd.matrixU();
-    ArrayXd          s = svd.singularValues().segment(0, k);
-    MatrixXd         result =
-        U.block(0, 0, U.rows(), k).array().rowwise() * s.transpose();
-    out = asFluid(result);
+    VectorXd mean = mB.rowwise().mean();
+    double   grandMean = mean.mean();
+    mB.array().colwise() -= mean.array();
+    mB.array().rowwise() -= mean.transpose().array();
+    mB.array() += grandMean;
+    mB *= -0.5;
   }
+
+  RowMatrixXd        mInput;
+  MatrixXd           mB;
+  MatrixXd           mLandmarkD;
+  MatrixXd           mResult;
+  std::vector<index> mLandmarks;
 };
 }; // namespace algorithm
 }; // namespace fluid
@@ -12,10 +12,13 @@ under the European Union’s Horizon 2020 research and innovation programme
 
 #include "../util/AlgorithmUtils.hpp"
 #include "../util/FluidEigenMappings.hpp"
+#include "../util/VectorKernels.hpp"
 #include "../../data/FluidIndex.hpp"
+#include "../../data/TensorTypes.hpp"
 #include <Eigen/Core>
 #include <cassert>
 #include <cmath>
+#include <vector>
 
 namespace fluid {
 namespace algorithm {
@@ -25,7 +28,10 @@ class MelBands
 public:
   MelBands(index maxBands, index maxFFT)
       : mFiltersStorage(maxBands, maxFFT / 2 + 1)
-  {}
+  {
+    mBandStart.reserve(asUnsigned(maxBands));
+    mBandEnd.reserve(asUnsigned(maxBands));
+  }
 
   /*static inline double mel2hz(double x) {
       return 700.0 * (exp(x / 1127.01048) - 1.0);
@@ -62,6 +68,17 @@ public:
       ArrayXd upper = ramps.row(i + 2) / melD(i + 1);
       mFilters.row(i) = lower.min(upper).max(0);
     }
+    // each triangle only covers a few bins, so keep its nonzero span
+    mBandStart.assign(asUnsigned(nBands), 0);
+    mBandEnd.assign(asUnsigned(nBands), 0);
+    for (index i = 0; i < nBands; i++)
+    {
+      index start = 0, end = nBins;
+      while (start < nBins && mFilters(i, start) == 0) start++;
+      while (end > start && mFilters(i, end - 1) == 0) end--;
+      mBandStart[asUnsigned(i)] = start;
+      mBandEnd[asUnsigned(i)] = end;
+    }
   }
 
   void processFrame(const RealVectorView in, RealVectorView out, bool magNorm,
@@ -71,11 +88,15 @@ public:
 
     ArrayXd frame = _impl::asEigen<Eigen::Array>(in);
     if (magNorm) frame = frame * mScale1;
-    ArrayXd result;
-    if (usePower) { result = (mFilters * frame.square().matrix()).array(); }
-    else
+    ArrayXd power;
+    if (usePower) power = frame.square();
+    const double* x = usePower ? power.data() : frame.data();
+    ArrayXd       result(mFilters.rows());
+    for (index i = 0; i < mFilters.rows(); i++)
     {
-      result = (mFilters * frame.matrix()).array();
+      index start = mBandStart[asUnsigned(i)];
+      result(i) = kernels::dot(mFilters.row(i).data() + start, x + start,
+                               mBandEnd[asUnsigned(i)] - start);
     }
     if (magNorm)
     {
@@ -90,8 +111,12 @@ public:
   double mScale1{1.0};
   double mScale2{1.0};
 
-  Eigen::MatrixXd mFilters;
-  Eigen::MatrixXd mFiltersStorage;
+  // row major, so that each band's weights are contiguous
+  Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>
+                     mFilters;
+  Eigen::MatrixXd    mFiltersStorage;
+  std::vector<index> mBandStart;
+  std::vector<index> mBandEnd;
 };
 } // namespace algorithm
 } // namespace fluid
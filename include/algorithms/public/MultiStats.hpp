@@ -11,14 +11,15 @@ under the European Union’s Horizon 2020 research and innovation programme
 #pragma once
 
 #include "../util/FluidEigenMappings.hpp"
+#include "../util/OrderStatistics.hpp"
 #include "../util/OutlierDetection.hpp"
-#include "../util/Stats.hpp"
-#include "../util/WeightedStats.hpp"
+#include "../util/ParallelFor.hpp"
 #include "../../data/FluidIndex.hpp"
 #include "../../data/TensorTypes.hpp"
 #include <Eigen/Core>
 #include <cassert>
 #include <cmath>
+#include <vector>
 
 namespace fluid {
 namespace algorithm {
@@ -28,6 +29,7 @@ class MultiStats
 public:
   using ArrayXd = Eigen::ArrayXd;
   using ArrayXi = Eigen::ArrayXi;
+  using ArrayXXd = Eigen::ArrayXXd;
 
   void init(index numDerivatives, double low, double mid, double high)
   {
@@ -38,6 +40,10 @@ public:
     mHigh = high / 100.0;
   }
 
+  // Upper bound on the threads used across channels; <= 0 means one per
+  // hardware thread
+  void setMaxThreads(index maxThreads) { mMaxThreads = maxThreads; }
+
   index numStats() { return 7; }
 
   ArrayXd diff(Eigen::Ref<ArrayXd> in)
@@ -50,95 +56,146 @@ public:
   {
     using namespace Eigen;
     using namespace _impl;
-    using fluid::Slice;
     assert(out.size() == in.rows() * numStats() * (mNumDerivatives + 1));
-    bool     weighted = w.size() > 0;
-    ArrayXXd input = asEigen<Array>(in);
-    ArrayXd  weights = asEigen<Array>(w);
-    index    numChannels = input.rows();
-    index    numFrames = input.cols();
-    ArrayXi  mask = ArrayXi::Ones(numFrames);
+    bool  weighted = w.size() > 0;
+    auto  input = asEigen<Array>(in);
+    index numChannels = input.rows();
+    index numFrames = input.cols();
+    index workers =
+        numWorkers(numChannels, kMinChannelsPerWorker, mMaxThreads);
+    workers = std::min(workers,
+                       std::max<index>(1, numChannels * numFrames /
+                                              kMinSamplesPerWorker));
+    if (asSigned(mWorkspaces.size()) < workers)
+      mWorkspaces.resize(asUnsigned(workers));
 
     if (cutoff >= 0)
     {
-      for (index i = 0; i < numChannels; i++)
-      { OutlierDetection().process(input.row(i), mask, cutoff); }
+      parallelFor(numChannels, workers, [&](index begin, index end, index id) {
+        Workspace& ws = mWorkspaces[asUnsigned(id)];
+        ws.mask.setOnes(numFrames);
+        for (index i = begin; i < end; i++)
+          ws.outliers.process(input.row(i), ws.mask, cutoff);
+      });
+    }
+
+    // frames kept by every channel's outlier test
+    mCleanFrames.clear();
+    for (index j = 0; j < numFrames; j++)
+    {
+      bool keep = true;
+      for (index id = 0; cutoff >= 0 && id < workers; id++)
+        keep = keep && mWorkspaces[asUnsigned(id)].mask(j) > 0;
+      if (keep) mCleanFrames.push_back(j);
     }
-    index numCleanFrames = mask.sum();
+    index numCleanFrames = asSigned(mCleanFrames.size());
     if (numCleanFrames <= 0) return;
-    if (weighted && weights.sum() <= 0) return;
-    ArrayXXd filtered = ArrayXXd::Zero(numChannels, numCleanFrames);
-    ArrayXd  filteredWeights;
-    if (weighted) filteredWeights = ArrayXd::Zero(numCleanFrames);
-    index k = 0;
-    for (index j = 0; j < mask.size(); j++)
+    if (weighted && asEigen<Array>(w).sum() <= 0) return;
+
+    if (weighted)
     {
-      if (mask(j) > 0)
-      {
-        filtered.col(k) = input.col(j);
-        if (weighted) filteredWeights(k) = weights(j);
-        k++;
-      }
+      mWeights.resize(numCleanFrames);
+      for (index j = 0; j < numCleanFrames; j++)
+        mWeights(j) = std::max(w(mCleanFrames[asUnsigned(j)]), 0.0);
+      double sum = mWeights.sum();
+      if (sum > 0) mWeights /= sum;
+    }
+
+    parallelFor(numChannels, workers, [&](index begin, index end, index id) {
+      Workspace& ws = mWorkspaces[asUnsigned(id)];
+      for (index i = begin; i < end; i++)
+        processChannel(input.row(i), out.row(i), weighted, ws);
+    });
+  }
+
+private:
+  struct Workspace
+  {
+    ArrayXXd         series;
+    ArrayXi          mask;
+    ArrayXi          perm;
+    OutlierDetection outliers;
+  };
+
+  // Gathers the clean frames and their derivatives in one sweep, then gets
+  // mean, std, skewness and kurtosis for all of them from one more sweep of
+  // central sums, before selecting percentiles
+  template <typename Row>
+  void processChannel(const Row& channel, RealVectorView out, bool weighted,
+                      Workspace& ws)
+  {
+    index numCleanFrames = asSigned(mCleanFrames.size());
+    index numSeries = std::min(mNumDerivatives + 1, numCleanFrames);
+    ws.series.resize(numCleanFrames, mNumDerivatives + 1);
+    out.fill(0);
+
+    double sum[3] = {0, 0, 0};
+    for (index j = 0; j < numCleanFrames; j++)
+    {
+      double weight = weighted ? mWeights(j) : 1.0;
+      ws.series(j, 0) = channel(mCleanFrames[asUnsigned(j)]);
+      for (index d = 1; d <= j && d < numSeries; d++)
+        ws.series(j - d, d) =
+            ws.series(j - d + 1, d - 1) - ws.series(j - d, d - 1);
+      for (index d = 0; d <= j && d < numSeries; d++)
+        sum[d] += weight * ws.series(j - d, d);
     }
-    filteredWeights = (filteredWeights >= 0).select(filteredWeights, 0);
-    if (weighted && filteredWeights.size() > 0)
+
+    double mean[3], m2[3] = {0, 0, 0}, m3[3] = {0, 0, 0}, m4[3] = {0, 0, 0};
+    for (index d = 0; d < numSeries; d++)
+      mean[d] = weighted ? sum[d] : sum[d] / (numCleanFrames - d);
+    for (index j = 0; j < numCleanFrames; j++)
     {
-      double sum = filteredWeights.sum();
-      if (sum > 0) filteredWeights = filteredWeights / filteredWeights.sum();
+      double weight = weighted ? mWeights(j) : 1.0;
+      for (index d = 0; d <= j && d < numSeries; d++)
+      {
+        double x = ws.series(j - d, d) - mean[d];
+        double x2 = x * x;
+        m2[d] += weight * x2;
+        m3[d] += weight * x2 * x;
+        m4[d] += weight * x2 * x2;
+      }
     }
-    ArrayXXd result =
-        ArrayXXd::Zero(numChannels, numStats() * (mNumDerivatives + 1));
-    for (index i = 0; i < numChannels; i++)
+
+    double fractions[] = {mLow, mMiddle, mHigh};
+    for (index d = 0; d < numSeries; d++)
     {
-      ArrayXd d1, d2, d1Weights, d2Weights;
-      ArrayXd channel = filtered.row(i);
-      result.block(i, 0, 1, numStats()) =
-          weighted
-              ? WeightedStats()
-                    .process(channel, filteredWeights, mLow, mMiddle, mHigh)
-                    .matrix()
-                    .transpose()
-              : Stats()
-                    .process(channel, mLow, mMiddle, mHigh)
-                    .matrix()
-                    .transpose();
-      if (mNumDerivatives > 0 && numCleanFrames >= 2)
+      index  length = numCleanFrames - d;
+      double norm = weighted ? 1.0 : 1.0 / length;
+      double stdev = std::sqrt(m2[d] * norm);
+      double scale = stdev == 0 ? 1 : stdev;
+      double stats[7] = {mean[d], stdev, m3[d] * norm / (scale * scale * scale),
+                         m4[d] * norm / (scale * scale * scale * scale)};
+      auto   values = ws.series.col(d).head(length);
+      if (weighted)
       {
-        d1 = diff(channel);
-        if (weighted)
-          d1Weights = filteredWeights.segment(1, numCleanFrames - 1);
-        result.block(i, numStats(), 1, numStats()) =
-            weighted ? WeightedStats()
-                           .process(d1, d1Weights, mLow, mMiddle, mHigh)
-                           .matrix()
-                           .transpose()
-                     : Stats()
-                           .process(d1, mLow, mMiddle, mHigh)
-                           .matrix()
-                           .transpose();
+        bool  inclusive[] = {true, false, false};
+        index fallbackRanks[] = {0, (length - 1) / 2, length - 1};
+        ws.perm.resize(length);
+        OrderStatistics::weightedQuantiles(values, mWeights.tail(length),
+                                           ws.perm, fractions, inclusive,
+                                           fallbackRanks, stats + 4, 3);
       }
-      if (mNumDerivatives > 1 && numCleanFrames >= 3)
+      else
       {
-        d2 = diff(d1);
-        if (weighted)
-          d2Weights = filteredWeights.segment(2, numCleanFrames - 2);
-        result.block(i, 2 * numStats(), 1, numStats()) =
-            weighted ? WeightedStats()
-                           .process(d2, d2Weights, mLow, mMiddle, mHigh)
-                           .matrix()
-                           .transpose()
-                     : Stats()
-                           .process(d2, mLow, mMiddle, mHigh)
-                           .matrix()
-                           .transpose();
+        OrderStatistics::quantiles(values, fractions, stats + 4, 3);
       }
+      for (index k = 0; k < numStats(); k++) out(d * numStats() + k) = stats[k];
     }
-    out = asFluid(result);
   }
-  index  mNumDerivatives{0};
-  double mLow{0};
-  double mMiddle{0.5};
-  double mHigh{1};
+
+  // below these, spreading channels over threads costs more than it saves
+  static constexpr index kMinChannelsPerWorker = 2;
+  static constexpr index kMinSamplesPerWorker = 1 << 16;
+
+  index                  mNumDerivatives{0};
+  double                 mLow{0};
+  double                 mMiddle{0.5};
+  double                 mHigh{1};
+  index                  mMaxThreads{0};
+  std::vector<index>     mCleanFrames;
+  ArrayXd                mWeights;
+  std::vector<Workspace> mWorkspaces;
 };
 } // namespace algorithm
 } // namespace fluid
@@ -12,6 +12,7 @@ under the European Union’s Horizon 2020 research and innovation programme
 
 #include "../util/AlgorithmUtils.hpp"
 #include "../util/FluidEigenMappings.hpp"
+#include "../util/VectorKernels.hpp"
 #include "../../data/FluidIndex.hpp"
 #include "../../data/TensorTypes.hpp"
 #include <Eigen/Core>
@@ -61,10 +62,13 @@ public:
     VectorXd ones = VectorXd::Ones(x.extent(0));
     while (nIterations--)
     {
-      ArrayXd  v1 = (W * h).array().max(epsilon);
-      ArrayXXd hNum = (WT * (v0.array() / v1).matrix()).array();
-      ArrayXXd hDen = (WT * ones).array();
-      h = (h.array() * hNum / hDen.max(epsilon)).matrix();
+      VectorXd ratio = W * h;
+      kernels::divideClamped(v0.data(), ratio.data(), epsilon, ratio.data(),
+                             ratio.size());
+      VectorXd hNum = WT * ratio;
+      VectorXd hDen = WT * ones;
+      kernels::multiplyDivideClamped(h.data(), hNum.data(), hDen.data(),
+                                     epsilon, h.size());
       // VectorXd r = W * h;
       // double divergence = (v.cwiseProduct(v.cwiseQuotient(r)) - v + r).sum();
       // std::cout<<"Divergence "<<divergence<<std::endl;
@@ -135,6 +139,9 @@ private:
                              bool updateW, bool updateH)
   {
     using namespace Eigen;
+    // the kernels below walk the raw storage
+    assert(V.outerStride() == V.rows() && W.outerStride() == W.rows() &&
+           H.outerStride() == H.rows());
     MatrixXd ones = MatrixXd::Ones(V.rows(), V.cols());
     H = H.array().max(epsilon).matrix();
     W = W.array().max(epsilon).matrix();
@@ -144,19 +151,26 @@ private:
     {
       if (updateW)
       {
-        ArrayXXd V1 = (W * H).array().max(epsilon);
-        ArrayXXd wnum = ((V.array() / V1).matrix() * H.transpose()).array();
-        ArrayXXd wden = (ones * H.transpose()).array();
-        W = (W.array() * wnum / wden.max(epsilon)).matrix();
+        // V / max(WH, epsilon)
+        MatrixXd ratio = W * H;
+        kernels::divideClamped(V.data(), ratio.data(), epsilon, ratio.data(),
+                               ratio.size());
+        MatrixXd wnum = ratio * H.transpose();
+        MatrixXd wden = ones * H.transpose();
+        kernels::multiplyDivideClamped(W.data(), wnum.data(), wden.data(),
+                                       epsilon, W.size());
         if (W.maxCoeff() > epsilon) W.colwise().normalize();
         assert(W.allFinite());
       }
-      ArrayXXd V2 = (W * H).array().max(epsilon);
       if (updateH)
       {
-        ArrayXXd hnum = (W.transpose() * (V.array() / V2).matrix()).array();
-        ArrayXXd hden = (W.transpose() * ones).array();
-        H = (H.array() * hnum / hden.max(epsilon)).matrix();
+        MatrixXd ratio = W * H;
+        kernels::divideClamped(V.data(), ratio.data(), epsilon, ratio.data(),
+                               ratio.size());
+        MatrixXd hnum = W.transpose() * ratio;
+        MatrixXd hden = W.transpose() * ones;
+        kernels::multiplyDivideClamped(H.data(), hnum.data(), hden.data(),
+                                       epsilon, H.size());
         assert(H.allFinite());
       }
       MatrixXd R = W * H;
@@ -0,0 +1,122 @@
+/*
+Part of the Fluid Corpus Manipulation Project (http://www.flucoma.org/)
+Copyright 2017-2019 University of Huddersfield.
+Licensed under the BSD-3 License.
+See license.md file in the project root for full license information.
+This project has received funding from the European Research Council (ERC)
+under the European Union’s Horizon 2020 research and innovation programme
+(grant agreement No 725899).
+*/
+
+#pragma once
+
+#include "HNSW.hpp"
+#include "KDTree.hpp"
+#include "../../data/FluidDataSet.hpp"
+#include "../../data/FluidIndex.hpp"
+#include "../../data/FluidTensor.hpp"
+#include "../../data/TensorTypes.hpp"
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace fluid {
+namespace algorithm {
+
+// Nearest neighbour search over a fitted dataset, either exact (KDTree) or
+// approximate (HNSW). Neighbours are reported by position, the point's row
+// in the fitted dataset (or its index in a restored model), so that callers
+// can keep per-point tables such as labels or targets
+class NeighbourIndex
+{
+public:
+  using string = std::string;
+  using DataSet = FluidDataSet<string, double, 1>;
+  using ConstRealVectorView = FluidTensorView<const double, 1>;
+  using Neighbour = std::pair<double, index>;
+
+  enum class Backend { kKDTree, kHNSW };
+
+  static constexpr index kDefaultSearchWidth = 50;
+
+  struct Workspace
+  {
+    HNSW::Workspace graph;
+  };
+
+  explicit NeighbourIndex() = default;
+
+  NeighbourIndex(const DataSet& dataset, index backend = 0)
+      : mBackend(static_cast<Backend>(backend)), mInitialized(true)
+  {
+    if (mBackend == Backend::kHNSW)
+      mGraph = HNSW(dataset);
+    else
+      mTree = KDTree(dataset);
+  }
+
+  explicit NeighbourIndex(KDTree tree)
+      : mTree(std::move(tree)), mBackend(Backend::kKDTree), mInitialized(true)
+  {}
+
+  explicit NeighbourIndex(HNSW graph)
+      : mGraph(std::move(graph)), mBackend(Backend::kHNSW), mInitialized(true)
+  {}
+
+  // Up to k (distance, position) pairs, nearest first; searchWidth is the
+  // HNSW beam width and is ignored by the exact search
+  void kNearest(ConstRealVectorView data, index k, double radius,
+                std::vector<Neighbour>& neighbours, Workspace& ws,
+                index searchWidth = kDefaultSearchWidth) const
+  {
+    if (mBackend == Backend::kHNSW)
+      mGraph.kNearest(data, k, radius, neighbours, ws.graph, searchWidth);
+    else
+      mTree.kNearest(data, k, radius, neighbours);
+  }
+
+  DataSet kNearest(ConstRealVectorView data, index k = 1, double radius = 0,
+                   index searchWidth = kDefaultSearchWidth) const
+  {
+    if (mBackend == Backend::kHNSW)
+      return mGraph.kNearest(data, k, radius, searchWidth);
+    return mTree.kNearest(data, k, radius);
+  }
+
+  // Point ids, indexed by position
+  FluidTensor<string, 1> ids() const
+  {
+    if (mBackend == Backend::kHNSW) return FluidTensor<string, 1>(mGraph.ids());
+    return mTree.ids();
+  }
+
+  Backend backend() const { return mBackend; }
+  index   dims() const
+  {
+    return mBackend == Backend::kHNSW ? mGraph.dims() : mTree.dims();
+  }
+  index size() const
+  {
+    return mBackend == Backend::kHNSW ? mGraph.size() : mTree.size();
+  }
+  bool initialized() const { return mInitialized; }
+
+  void clear()
+  {
+    mTree = KDTree(DataSet(0));
+    mGraph.clear();
+    mBackend = Backend::kKDTree;
+    mInitialized = false;
+  }
+
+  const KDTree& tree() const { return mTree; }
+  const HNSW&   graph() const { return mGraph; }
+
+private:
+  KDTree  mTree{DataSet(0)};
+  HNSW    mGraph;
+  Backend mBackend{Backend::kKDTree};
+  bool    mInitialized{false};
+};
+} // namespace algorithm
+} // namespace fluid
@@ -28,19 +28,37 @@ public:
 
   void init(double min, double max, RealMatrixView in)
   {
-    using namespace Eigen;
-    using namespace _impl;
     mMin = min;
     mMax = max;
-    ArrayXXd input = asEigen<Array>(in);
-    mDataMin = input.colwise().minCoeff();
-    mDataMax = input.colwise().maxCoeff();
+    mCount = 0;
+    partialFit(in);
+  }
+
+  // Widens the running per-column data range to cover a chunk of rows
+  void partialFit(RealMatrixView in)
+  {
+    using namespace Eigen;
+    using namespace _impl;
+    auto input = asEigen<Array>(in);
+    if (mCount == 0)
+    {
+      mDataMin = input.colwise().minCoeff().transpose();
+      mDataMax = input.colwise().maxCoeff().transpose();
+    }
+    else
+    {
+      mDataMin = mDataMin.min(input.colwise().minCoeff().transpose());
+      mDataMax = mDataMax.max(input.colwise().maxCoeff().transpose());
+    }
+    mCount += input.rows();
     mDataRange = mDataMax - mDataMin;
     mInitialized = true;
   }
 
+  // count is the number of points fitted, if known, so that partialFit()
+  // can continue the fit; with 0 it can't (see count())
   void init(double min, double max, RealVectorView dataMin,
-            RealVectorView dataMax)
+            RealVectorView dataMax, index count = 0)
   {
     using namespace Eigen;
     using namespace _impl;
@@ -50,6 +68,7 @@ public:
     mDataMax = asEigen<Array>(dataMax);
     mDataRange = mDataMax - mDataMin;
     mDataRange = mDataRange.max(epsilon);
+    mCount = count;
     mInitialized = true;
   }
 
@@ -116,6 +135,7 @@ public:
   }
 
   index dims() const { return mDataMin.size(); }
+  index count() const { return mCount; }
   index size() const { return 1; }
 
   void clear()
@@ -125,6 +145,7 @@ public:
     mDataMin.setZero();
     mDataMax.setZero();
     mDataRange.setZero();
+    mCount = 0;
     mInitialized = false;
   }
 
@@ -133,6 +154,7 @@ public:
   ArrayXd mDataMin;
   ArrayXd mDataMax;
   ArrayXd mDataRange;
+  index   mCount{0};
   bool    mInitialized{false};
 };
 }; // namespace algorithm
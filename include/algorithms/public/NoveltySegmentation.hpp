@@ -41,7 +41,8 @@ public:
   double processFrame(const RealVectorView input, double threshold,
                       index minSliceLength)
   {
-    double novelty = mNovelty.processFrame(_impl::asEigen<Eigen::Array>(input));
+    mFrame = _impl::asEigen<Eigen::Array>(input);
+    double novelty = mNovelty.processFrame(mFrame);
     double detected = 0.;
     index  filterSize = mFilterBuffer.size();
     if (filterSize > 1)
@@ -69,6 +70,7 @@ private:
   ArrayXd mFilterBuffer;
   ArrayXd mFilterBufferStorage;
   ArrayXd mPeakBuffer{3};
+  ArrayXd mFrame;
   Novelty mNovelty;
   index   mDebounceCount{1};
 };
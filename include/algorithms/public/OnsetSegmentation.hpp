@@ -38,6 +38,8 @@ public:
     makeWindow(windowSize);
     prevFrame = ArrayXcd::Zero(fftSize / 2 + 1);
     prevPrevFrame = ArrayXcd::Zero(fftSize / 2 + 1);
+    mFrame.resize(fftSize / 2 + 1);
+    mDelayedFrame.resize(fftSize / 2 + 1);
     mFilter.init(filterSize);
     mFFT.resize(fftSize);
     mDebounceCount = 1;
@@ -66,26 +68,27 @@ public:
         (!mFilter.initialized() || filterSize != mFilter.size()))
       mFilter.init(filterSize);
 
-    ArrayXcd frame = mFFT.process(in.segment(0, mWindowSize) * mWindow);
-    auto     odf = static_cast<OnsetDetectionFuncs::ODF>(function);
+    // the frame buffers are sized in init(), so this doesn't allocate
+    mFrame = mFFT.process(in.segment(0, mWindowSize) * mWindow);
+    auto odf = static_cast<OnsetDetectionFuncs::ODF>(function);
     if (function > 1 && function < 5 && frameDelta != 0)
     {
-      ArrayXcd frame2 =
+      mDelayedFrame =
           mFFT.process(in.segment(frameDelta, mWindowSize) * mWindow);
-      funcVal = OnsetDetectionFuncs::map()[odf](frame2, frame, frame);
+      funcVal = OnsetDetectionFuncs::map()[odf](mDelayedFrame, mFrame, mFrame);
     }
     else
     {
       funcVal =
-          OnsetDetectionFuncs::map()[odf](frame, prevFrame, prevPrevFrame);
+          OnsetDetectionFuncs::map()[odf](mFrame, prevFrame, prevPrevFrame);
     }
     if (filterSize >= 3)
       filteredFuncVal = funcVal - mFilter.processSample(funcVal);
     else
       filteredFuncVal = funcVal - mPrevFuncVal;
 
-    prevPrevFrame = prevFrame;
-    prevFrame = frame;
+    prevPrevFrame.swap(prevFrame);
+    prevFrame.swap(mFrame);
 
     if (filteredFuncVal > threshold && mPrevFuncVal < threshold &&
         mDebounceCount == 0)
@@ -108,6 +111,8 @@ private:
   ArrayXd      mWindow;
   index        mWindowSize{1024};
   index        mDebounceCount{1};
+  ArrayXcd     mFrame;
+  ArrayXcd     mDelayedFrame;
   ArrayXcd     prevFrame;
   ArrayXcd     prevPrevFrame;
   double       mPrevFuncVal{0.0};
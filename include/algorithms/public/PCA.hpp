@@ -13,9 +13,12 @@ under the European Union’s Horizon 2020 research and innovation programme
 #include "../util/FluidEigenMappings.hpp"
 #include "../../data/TensorTypes.hpp"
 #include <Eigen/Core>
+#include <Eigen/QR>
 #include <Eigen/SVD>
+#include <algorithm>
 #include <cassert>
 #include <cmath>
+#include <random>
 
 namespace fluid {
 namespace algorithm {
@@ -26,36 +29,98 @@ public:
   using MatrixXd = Eigen::MatrixXd;
   using VectorXd = Eigen::VectorXd;
 
-  void init(RealMatrixView in)
+  enum class Method { kExact, kRandomized };
+
+  // kExact: thin SVD of the whole centered input, keeping every component
+  // kRandomized: randomized range finder (Halko et al. 2011), computing only
+  // the first numComponents bases; the input is centered implicitly
+  void init(RealMatrixView in, index method = 0, index numComponents = 0)
   {
     using namespace Eigen;
     using namespace _impl;
-    MatrixXd input = asEigen<Matrix>(in);
+    auto input = asEigen<Matrix>(in);
     mMean = input.colwise().mean();
-    MatrixXd         X = (input.rowwise() - mMean.transpose());
-    BDCSVD<MatrixXd> svd(X.matrix(), ComputeThinV | ComputeThinU);
-    mBases = svd.matrixV();
-    mValues = svd.singularValues();
+    index maxRank = std::min(input.rows(), input.cols());
+    index sketchSize = numComponents + kOversampling;
+    if (static_cast<Method>(method) == Method::kRandomized &&
+        numComponents > 0 && sketchSize < maxRank)
+    {
+      randomizedInit(in, numComponents, sketchSize);
+    }
+    else
+    {
+      // U is never used, and is by far the largest factor for tall input
+      BDCSVD<MatrixXd> svd(input.rowwise() - mMean.transpose(), ComputeThinV);
+      mBases = svd.matrixV();
+      mValues = svd.singularValues();
+    }
+    mCount = input.rows();
+    mProjectedMean = mBases.transpose() * mMean;
     mInitialized = true;
   }
 
-  void init(RealMatrixView bases, RealVectorView values, RealVectorView mean)
+  // count is the number of points fitted, if known, so that partialFit()
+  // can continue the fit; with 0 it can't (see count())
+  void init(RealMatrixView bases, RealVectorView values, RealVectorView mean,
+            index count = 0)
   {
     mBases = _impl::asEigen<Eigen::Matrix>(bases);
     mValues = _impl::asEigen<Eigen::Matrix>(values);
     mMean = _impl::asEigen<Eigen::Matrix>(mean);
+    mCount = count;
+    mProjectedMean = mBases.transpose() * mMean;
+    mInitialized = true;
+  }
+
+  // Incremental PCA (Ross et al. 2008): the current model, summarised as
+  // diag(S) * V', is stacked with the centered chunk and a mean-shift row,
+  // and re-factorised. Only a (size() + rows + 1) x dims matrix is formed,
+  // and while every component is kept the result equals a batch fit
+  void partialFit(RealMatrixView in)
+  {
+    using namespace Eigen;
+    using namespace _impl;
+    auto     input = asEigen<Matrix>(in);
+    index    n = input.rows();
+    VectorXd chunkMean = input.colwise().mean();
+    if (mCount == 0)
+    {
+      BDCSVD<MatrixXd> svd(input.rowwise() - chunkMean.transpose(),
+                           ComputeThinV);
+      mBases = svd.matrixV();
+      mValues = svd.singularValues();
+      mMean = chunkMean;
+    }
+    else
+    {
+      index    r = mValues.size();
+      double   total = static_cast<double>(mCount + n);
+      MatrixXd stacked(r + n + 1, input.cols());
+      stacked.topRows(r) = mValues.asDiagonal() * mBases.transpose();
+      stacked.middleRows(r, n) = input.rowwise() - chunkMean.transpose();
+      stacked.bottomRows(1) = std::sqrt(mCount * (n / total)) *
+                              (mMean - chunkMean).transpose();
+      BDCSVD<MatrixXd> svd(stacked, ComputeThinV);
+      mBases = svd.matrixV();
+      mValues = svd.singularValues();
+      mMean += (chunkMean - mMean) * (n / total);
+    }
+    mCount += n;
+    mProjectedMean = mBases.transpose() * mMean;
     mInitialized = true;
   }
 
+  // (x - mean)' * B is evaluated as x' * B - mean' * B, with the second term
+  // precomputed, so that nothing is allocated per frame
   void processFrame(const RealVectorView in, RealVectorView out, index k) const
   {
     using namespace Eigen;
     using namespace _impl;
     if (k > mBases.cols()) return;
-    VectorXd input = asEigen<Matrix>(in);
-    input = input - mMean;
-    VectorXd result = input.transpose() * mBases.block(0, 0, mBases.rows(), k);
-    out = _impl::asFluid(result);
+    auto input = asEigen<Matrix>(in);
+    auto result = asEigen<Matrix>(out);
+    result.noalias() = mBases.leftCols(k).transpose() * input;
+    result -= mProjectedMean.head(k);
   }
 
   double process(const RealMatrixView in, RealMatrixView out, index k) const
@@ -63,13 +128,12 @@ public:
     using namespace Eigen;
     using namespace _impl;
     if (k > mBases.cols()) return 0;
-    MatrixXd input = asEigen<Matrix>(in);
-    MatrixXd result = (input.rowwise() - mMean.transpose()) *
-                      mBases.block(0, 0, mBases.rows(), k);
+    auto result = asEigen<Matrix>(out);
+    result.noalias() = asEigen<Matrix>(in) * mBases.leftCols(k);
+    result.rowwise() -= mProjectedMean.head(k).transpose();
     double variance = 0;
     double total = mValues.sum();
     for (index i = 0; i < k; i++) variance += mValues[i];
-    out = _impl::asFluid(result);
     return variance / total;
   }
 
@@ -79,16 +143,74 @@ public:
   void  getMean(RealVectorView out) const { out = _impl::asFluid(mMean); }
   index dims() const { return mBases.rows(); }
   index size() const { return mBases.cols(); }
+  index count() const { return mCount; }
   void  clear()
   {
     mBases.setZero();
     mMean.setZero();
+    mProjectedMean.setZero();
+    mCount = 0;
     mInitialized = false;
   }
 
+private:
+  void randomizedInit(RealMatrixView in, index k, index sketchSize)
+  {
+    using namespace Eigen;
+    using namespace _impl;
+    auto     input = asEigen<Matrix>(in);
+    MatrixXd range(input.rows(), sketchSize);
+    MatrixXd coRange(input.cols(), sketchSize);
+
+    // fixed seed, so that fitting the same data gives the same bases
+    std::mt19937                     engine(kSeed);
+    std::normal_distribution<double> gaussian;
+    coRange = MatrixXd::NullaryExpr(input.cols(), sketchSize,
+                                    [&]() { return gaussian(engine); });
+
+    // (X - 1 * mean') * M = X * M - 1 * (mean' * M), and likewise for the
+    // transpose, so the centered matrix is never formed
+    auto sampleRange = [&]() {
+      range.noalias() = input * coRange;
+      range.rowwise() -= mMean.transpose() * coRange;
+      orthonormalize(range);
+    };
+    auto sampleCoRange = [&]() {
+      coRange.noalias() = input.transpose() * range;
+      coRange -= mMean * range.colwise().sum();
+    };
+
+    sampleRange();
+    for (index i = 0; i < kPowerIterations; i++)
+    {
+      sampleCoRange();
+      orthonormalize(coRange);
+      sampleRange();
+    }
+    sampleCoRange();
+
+    // coRange is now B' = (Q' X)', whose SVD gives the leading right
+    // singular vectors and values of X
+    JacobiSVD<MatrixXd> svd(coRange, ComputeThinU);
+    mBases = svd.matrixU().leftCols(k);
+    mValues = svd.singularValues().head(k);
+  }
+
+  static void orthonormalize(Eigen::MatrixXd& m)
+  {
+    Eigen::HouseholderQR<Eigen::MatrixXd> qr(m);
+    m = qr.householderQ() * Eigen::MatrixXd::Identity(m.rows(), m.cols());
+  }
+
+  static constexpr index    kOversampling = 10;
+  static constexpr index    kPowerIterations = 2;
+  static constexpr unsigned kSeed = 42;
+
   MatrixXd mBases;
   VectorXd mValues;
   VectorXd mMean;
+  VectorXd mProjectedMean;
+  index    mCount{0};
   bool     mInitialized{false};
 };
 }; // namespace algorithm
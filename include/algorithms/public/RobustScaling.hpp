@@ -12,6 +12,7 @@ under the European Union’s Horizon 2020 research and innovation programme
 #pragma once
 
 #include "../util/FluidEigenMappings.hpp"
+#include "../util/OrderStatistics.hpp"
 #include "../../data/TensorTypes.hpp"
 #include <Eigen/Core>
 #include <cassert>
@@ -33,19 +34,21 @@ public:
     const double epsilon = std::numeric_limits<double>::epsilon();
     mLow = low;
     mHigh = high;
-    ArrayXXd input = asEigen<Array>(in);
+    auto input = asEigen<Array>(in);
     mDataLow.resize(input.cols());
     mDataHigh.resize(input.cols());
     mMedian.resize(input.cols());
     mRange.resize(input.cols());
-    index length = input.rows();
+    double  fractions[] = {0.5, mLow / 100.0, mHigh / 100.0};
+    double  quantiles[3];
+    ArrayXd column(input.rows());
     for (index i = 0; i < input.cols(); i++)
     {
-      ArrayXd sorted = input.col(i);
-      std::sort(sorted.data(), sorted.data() + length);
-      mMedian(i) = sorted(lrint(0.5 * (length - 1)));
-      mDataLow(i) = sorted(lrint((mLow / 100.0) * (length - 1)));
-      mDataHigh(i) = sorted(lrint((mHigh / 100.0) * (length - 1)));
+      column = input.col(i);
+      OrderStatistics::quantiles(column, fractions, quantiles, 3);
+      mMedian(i) = quantiles[0];
+      mDataLow(i) = quantiles[1];
+      mDataHigh(i) = quantiles[2];
     }
     mRange = mDataHigh - mDataLow;
     mRange = mRange.max(epsilon);
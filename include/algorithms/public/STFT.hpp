@@ -14,11 +14,13 @@ under the European Union’s Horizon 2020 research and innovation programme
 #include "../util/AlgorithmUtils.hpp"
 #include "../util/FFT.hpp"
 #include "../util/FluidEigenMappings.hpp"
+#include "../util/ParallelFor.hpp"
 #include "../../data/FluidIndex.hpp"
 #include "../../data/FluidTensor.hpp"
 #include "../../data/TensorTypes.hpp"
 #include <Eigen/Core>
 #include <cmath>
+#include <memory>
 
 namespace fluid {
 namespace algorithm {
@@ -33,7 +35,7 @@ class STFT
 public:
   STFT(index windowSize, index fftSize, index hopSize, index windowType = 0)
       : mWindowSize(windowSize), mHopSize(hopSize), mFrameSize(fftSize / 2 + 1),
-        mFFT(fftSize)
+        mFFT(fftSize), mFrameBuffer(windowSize)
   {
     mWindow = ArrayXd::Zero(mWindowSize);
     auto windowTypeIndex = static_cast<WindowFuncs::WindowTypes>(windowType);
@@ -68,24 +70,61 @@ public:
           FluidTensorView<double, 2>(out));
   }
 
+  // From split real and imaginary parts, e.g. FFT::processSplit, which avoids
+  // complex arithmetic altogether
+  static void magnitude(const Eigen::Ref<const ArrayXd>& real,
+                        const Eigen::Ref<const ArrayXd>& imag,
+                        FluidTensorView<double, 1>       out)
+  {
+    assert(out.size() == real.size());
+    _impl::asEigen<Eigen::Array>(out) = (real.square() + imag.square()).sqrt();
+  }
 
-  void process(const RealVectorView audio, ComplexMatrixView spectrogram)
+  static void phase(const Eigen::Ref<const ArrayXd>& real,
+                    const Eigen::Ref<const ArrayXd>& imag,
+                    FluidTensorView<double, 1>       out)
   {
-    index   halfWindow = mWindowSize / 2;
-    ArrayXd padded(audio.size() + mWindowSize + mHopSize);
-    padded.fill(0);
-    padded.segment(halfWindow, audio.size()) =
-        Eigen::Map<const ArrayXd>(audio.data(), audio.size());
-    index nFrames = static_cast<index>(
-        std::floor((padded.size() - mWindowSize) / mHopSize));
+    assert(out.size() == real.size());
+    _impl::asEigen<Eigen::Array>(out) = imag.binaryExpr(
+        real, [](double y, double x) { return std::atan2(y, x); });
+  }
 
-    ArrayXXcd result(nFrames, mFrameSize);
-    for (index i = 0; i < nFrames; i++)
-    {
-      result.row(i) =
-          mFFT.process(padded.segment(i * mHopSize, mWindowSize) * mWindow);
-    }
-    spectrogram = _impl::asFluid(result);
+
+  // Frames are centred on multiples of the hop, padding the audio with half
+  // a window of zeros at the start and a window and a hop at the end
+  void process(const RealVectorView audio, ComplexMatrixView spectrogram,
+               index maxWorkers = 1)
+  {
+    assert(spectrogram.rows() == (audio.size() + mHopSize) / mHopSize);
+    processFrames(audio, -(mWindowSize / 2), 0, spectrogram, maxWorkers);
+  }
+
+  // Batched analysis into out, one row per frame: row i is frame
+  // firstFrame + i, whose window starts at sample offset + frame * hopSize of
+  // audio, with zeros wherever it overhangs. The frames are split into
+  // contiguous runs over up to maxWorkers threads (0 for one per core), each
+  // windowing straight from the audio into its own FFT; the first runs on the
+  // calling thread with this STFT's own FFT and frame buffer
+  void processFrames(const RealVectorView audio, index offset,
+                     index firstFrame, ComplexMatrixView out,
+                     index maxWorkers = 1)
+  {
+    assert(audio.descriptor().strides[0] == 1);
+    assert(out.cols() == mFrameSize);
+    index nFrames = out.rows();
+    index workers = numWorkers(nFrames, kMinFramesPerWorker, maxWorkers);
+    parallelFor(nFrames, workers, [&](index begin, index end, index worker) {
+      std::unique_ptr<FFT> ownFFT;
+      if (worker > 0) ownFFT = std::make_unique<FFT>(2 * (mFrameSize - 1));
+      FFT&     fft = worker > 0 ? *ownFFT : mFFT;
+      ArrayXd  ownFrame(worker > 0 ? mWindowSize : 0);
+      ArrayXd& frame = worker > 0 ? ownFrame : mFrameBuffer;
+      for (index i = begin; i < end; i++)
+      {
+        windowFrame(audio, offset + (firstFrame + i) * mHopSize, frame);
+        _impl::asEigen<Eigen::Array>(out.row(i)) = fft.process(frame);
+      }
+    });
   }
 
   void processFrame(const RealVectorView frame, ComplexVectorView out)
@@ -102,6 +141,18 @@ public:
     out = mFFT.process(frame * mWindow);
   }
 
+  // Only the magnitude spectrum (or power, if asked) of a frame, for analyses
+  // that ignore phase; no complex spectrum is formed and nothing is allocated
+  void processFrameMagnitude(const RealVectorView frame, RealVectorView out,
+                             bool power = false)
+  {
+    assert(frame.size() == mWindowSize);
+    assert(out.size() == mFrameSize && out.descriptor().strides[0] == 1);
+    mFrameBuffer = _impl::asEigen<Eigen::Array>(frame) * mWindow;
+    mFFT.processMagnitude(mFrameBuffer,
+                          Eigen::Map<ArrayXd>(out.data(), mFrameSize), power);
+  }
+
 
   RealVectorView window()
   {
@@ -109,11 +160,25 @@ public:
   }
 
 private:
+  static constexpr index kMinFramesPerWorker = 32;
+
+  void windowFrame(const RealVectorView audio, index start, ArrayXd& frame)
+  {
+    index lo = std::min(std::max<index>(0, -start), mWindowSize);
+    index hi = std::max(std::min(mWindowSize, audio.size() - start), lo);
+    frame.head(lo).setZero();
+    frame.segment(lo, hi - lo) =
+        Eigen::Map<const ArrayXd>(audio.data() + start + lo, hi - lo) *
+        mWindow.segment(lo, hi - lo);
+    frame.tail(mWindowSize - hi).setZero();
+  }
+
   index   mWindowSize;
   index   mHopSize;
   index   mFrameSize;
   ArrayXd mWindow;
   FFT     mFFT;
+  ArrayXd mFrameBuffer;
 };
 
 class ISTFT
@@ -92,7 +92,7 @@ public:
     mOutputBuffer(6) = 20 * log10(max(crest, epsilon));
   }
 
-  void processFrame(const RealVector& input, RealVectorView output,
+  void processFrame(const RealVectorView input, RealVectorView output,
                     double sampleRate, double minFreq = 0, double maxFreq = -1,
                     double rolloffTarget = 0.95, bool logFreq = false,
                     bool usePower = false)
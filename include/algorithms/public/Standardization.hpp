@@ -27,22 +27,54 @@ public:
   using ArrayXXd = Eigen::ArrayXXd;
 
   void init(RealMatrixView in)
+  {
+    mCount = 0;
+    partialFit(in);
+  }
+
+  // Folds a chunk of rows into the running mean and sum of squared deviations
+  // (Chan et al.'s pairwise form of Welford's update), so a fit can be built
+  // from successive chunks without holding all of them at once
+  void partialFit(RealMatrixView in)
   {
     using namespace Eigen;
     using namespace _impl;
-    ArrayXXd input = asEigen<Array>(in);
-    mMean = input.colwise().mean();
-    mStd = ((input.rowwise() - mMean.transpose()).square().colwise().mean())
-               .sqrt();
+    auto    input = asEigen<Array>(in);
+    index   n = input.rows();
+    ArrayXd chunkMean = input.colwise().mean().transpose();
+    ArrayXd chunkM2 = (input.rowwise() - chunkMean.transpose())
+                          .square()
+                          .colwise()
+                          .sum()
+                          .transpose();
+    if (mCount == 0)
+    {
+      mMean = chunkMean;
+      mM2 = chunkM2;
+    }
+    else
+    {
+      double  total = static_cast<double>(mCount + n);
+      ArrayXd delta = chunkMean - mMean;
+      mMean += delta * (n / total);
+      mM2 += chunkM2 + delta.square() * (mCount * (n / total));
+    }
+    mCount += n;
+    mStd = (mM2 / mCount).sqrt();
     mInitialized = true;
   }
 
-  void init(const RealVectorView mean, const RealVectorView std)
+  // count is the number of points fitted, if known, so that partialFit()
+  // can continue the fit; with 0 it can't (see count())
+  void init(const RealVectorView mean, const RealVectorView std,
+            index count = 0)
   {
     using namespace Eigen;
     using namespace _impl;
     mMean = asEigen<Array>(mean);
     mStd = asEigen<Array>(std);
+    mM2 = mStd.square() * count;
+    mCount = count;
     mInitialized = true;
   }
 
@@ -89,17 +121,21 @@ public:
   void getStd(RealVectorView out) const { out = _impl::asFluid(mStd); }
 
   index dims() const { return mMean.size(); }
+  index count() const { return mCount; }
   index size() const { return 1; }
 
   void clear()
   {
     mMean.setZero();
     mStd.setZero();
+    mCount = 0;
     mInitialized = false;
   }
 
   ArrayXd mMean;
   ArrayXd mStd;
+  ArrayXd mM2;
+  index   mCount{0};
   bool    mInitialized{false};
 };
 }; // namespace algorithm
@@ -37,8 +37,8 @@ public:
     ArrayXd       squareMagSym(2 * (nBins - 1));
     squareMagSym << squareMag[0], squareMag.segment(1, nBins - 1),
         squareMag.segment(1, nBins - 2).reverse();
-    ArrayXcd squareMagFFT = fft.process(squareMagSym);
-    ArrayXd  yin = squareMagSum - squareMagFFT.real();
+    // only the real part is needed
+    ArrayXd yin = squareMagSum - fft.processSplit(squareMagSym).real;
     if (maxFreq == 0) maxFreq = 1;
     if (minFreq == 0) minFreq = 1;
     yin(0) = 1;
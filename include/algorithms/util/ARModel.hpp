@@ -11,13 +11,15 @@ under the European Union’s Horizon 2020 research and innovation programme
 #pragma once
 
 #include "ConvolutionTools.hpp"
-#include "Toeplitz.hpp"
 #include "../public/WindowFuncs.hpp"
 #include "../../data/FluidIndex.hpp"
 #include <Eigen/Eigen>
+#include <HISSTools_FFT/HISSTools_FFT.h>
 #include <algorithm>
 #include <cmath>
 #include <functional>
+#include <memory>
+#include <vector>
 
 namespace fluid {
 namespace algorithm {
@@ -30,7 +32,11 @@ class ARModel
   using VectorXd = Eigen::VectorXd;
 
 public:
-  ARModel(index order) : mParameters(VectorXd::Zero(order)) {}
+  ARModel(index order)
+      : mParameters(VectorXd::Zero(order)),
+        mAutocorrelation(VectorXd::Zero(order + 1)),
+        mLevinsonBuffer(VectorXd::Zero(order))
+  {}
 
   const double* getParameters() const { return mParameters.data(); }
   double        variance() const { return mVariance; }
@@ -108,7 +114,7 @@ private:
   void directEstimate(const double* input, index size, bool updateVariance)
   {
     // copy input to a 32 byte aligned block (otherwise risk segfaults on Linux)
-    VectorXd frame = Eigen::Map<const VectorXd>(input, size);
+    mFrame = Eigen::Map<const VectorXd>(input, size);
 
     if (mUseWindow)
     {
@@ -118,46 +124,115 @@ private:
         WindowFuncs::map()[WindowFuncs::WindowTypes::kHann](size, mWindow);
       }
 
-      frame.array() *= mWindow;
+      mFrame.array() *= mWindow;
     }
 
+    autocorrelate(size);
 
-    VectorXd autocorrelation(size);
-    algorithm::autocorrelateReal(autocorrelation.data(), frame.data(),
-                                 asUnsigned(size));
+    // Yule Walker (Levinson-Durbin)
+    double error = levinson();
 
-    // Resize to the desired order (only keep coefficients for up to the order
-    // we need)
-    double pN = mParameters.size() < size ? autocorrelation(mParameters.size())
-                                          : autocorrelation(0);
-    autocorrelation.conservativeResize(mParameters.size());
+    if (updateVariance) setVariance(error / size);
+  }
+
+  // Circular autocorrelation up to lag order (the same values the
+  // kEdgeWrap correlateReal() produces). Short lag ranges are computed
+  // directly; otherwise a cached real FFT of the zero-padded frame is used
+  void autocorrelate(index size)
+  {
+    const index maxLag = std::min(order(), size - 1);
+    const index log2Size =
+        static_cast<index>(impl::ilog2(asUnsigned(2 * size - 1)));
+    const index fftSize = index(1) << log2Size;
+
+    mAutocorrelation.setZero();
+
+    if ((maxLag + 1) * size <= kDirectCostFactor * fftSize * log2Size)
+    {
+      Eigen::Map<const VectorXd> x(mFrame.data(), size);
+      for (index k = 0; k <= maxLag; k++)
+      {
+        mAutocorrelation(k) = x.head(size - k).dot(x.tail(size - k)) +
+                              x.head(k).dot(x.tail(k));
+      }
+      return;
+    }
+
+    if (!mFFTSetup || log2Size > mFFTMaxLog2Size)
+    {
+      mFFTSetup.reset(new impl::FFTRealSetup(asUnsigned(log2Size)));
+      mFFTMaxLog2Size = log2Size;
+    }
+
+    if (mCorrelation.size() < fftSize)
+    {
+      mCorrelation.resize(fftSize);
+      mSpectrumReal.resize(fftSize / 2);
+      mSpectrumImag.resize(fftSize / 2);
+    }
 
-    // Form a toeplitz matrix
-    MatrixXd mat = toeplitz(autocorrelation);
+    FFT_SPLIT_COMPLEX_D split;
+    split.realp = mSpectrumReal.data();
+    split.imagp = mSpectrumImag.data();
+
+    hisstools_rfft(mFFTSetup->mSetup, mFrame.data(), &split, asUnsigned(size),
+                   asUnsigned(log2Size));
+
+    // DC and Nyquist are packed into the first real / imaginary slots
+    const index  halfSize = fftSize / 2;
+    const double dc = split.realp[0] * split.realp[0];
+    const double nyquist = split.imagp[0] * split.imagp[0];
+    mSpectrumReal.head(halfSize) = mSpectrumReal.head(halfSize).square() +
+                                   mSpectrumImag.head(halfSize).square();
+    mSpectrumImag.head(halfSize).setZero();
+    split.realp[0] = dc;
+    split.imagp[0] = nyquist;
+
+    hisstools_rifft(mFFTSetup->mSetup, &split, mCorrelation.data(),
+                    asUnsigned(log2Size));
+
+    const double scale = 0.25 / static_cast<double>(fftSize);
+    mAutocorrelation(0) = scale * mCorrelation(0);
+    for (index k = 1; k <= maxLag; k++)
+      mAutocorrelation(k) = scale * (mCorrelation(k) + mCorrelation(size - k));
+  }
 
-    // Yule Walker
-    autocorrelation(0) = pN;
-    std::rotate(autocorrelation.data(), autocorrelation.data() + 1,
-                autocorrelation.data() + mParameters.size());
-    mParameters = mat.llt().solve(autocorrelation);
+  // Solve the Toeplitz normal equations in O(order^2), returning the final
+  // prediction error. Stops early (leaving the remaining coefficients at zero)
+  // if the error vanishes, e.g. for silent input
+  double levinson()
+  {
+    const index order = mParameters.size();
+    double      error = mAutocorrelation(0);
 
-    if (updateVariance)
+    mParameters.setZero();
+
+    for (index m = 0; m < order && error > 0; m++)
     {
-      // Calculate variance
-      double variance = mat(0, 0);
+      double acc = mAutocorrelation(m + 1);
+      for (index j = 0; j < m; j++)
+        acc -= mParameters(j) * mAutocorrelation(m - j);
+
+      const double reflection = acc / error;
 
-      for (index i = 0; i < mParameters.size() - 1; i++)
-        variance -= mParameters(i) * mat(0, i + 1);
+      for (index j = 0; j < m; j++)
+        mLevinsonBuffer(j) =
+            mParameters(j) - reflection * mParameters(m - 1 - j);
 
-      setVariance((variance - (mParameters(mParameters.size() - 1) * pN)) /
-                  size);
+      mParameters.head(m) = mLevinsonBuffer.head(m);
+      mParameters(m) = reflection;
+      error *= (1.0 - reflection * reflection);
     }
+
+    return error;
   }
 
   void robustEstimate(const double* input, index size, index nIterations,
                       double robustFactor)
   {
-    std::vector<double> estimates(asUnsigned(size + mParameters.size()));
+    std::vector<double>& estimates = mEstimates;
+    estimates.resize(asUnsigned(size + mParameters.size()));
+    std::fill_n(estimates.begin(), mParameters.size(), 0.0);
 
     // Calculate an initial estimate of parameters
     directEstimate(input, size, true);
@@ -227,11 +302,26 @@ private:
     return fabs(x) > 1 ? std::copysign(1.0, x) : x;
   }
 
+  // below this ratio of direct to FFT operation counts, autocorrelation is
+  // computed directly
+  static constexpr index kDirectCostFactor = 4;
+
   VectorXd mParameters;
   double   mVariance{0.0};
   ArrayXd  mWindow;
   bool     mUseWindow{true};
   double   mMinVariance{0.0};
+
+  // working storage, kept across calls
+  VectorXd                            mFrame;
+  VectorXd                            mAutocorrelation;
+  VectorXd                            mLevinsonBuffer;
+  std::vector<double>                 mEstimates;
+  ArrayXd                             mCorrelation;
+  ArrayXd                             mSpectrumReal;
+  ArrayXd                             mSpectrumImag;
+  std::unique_ptr<impl::FFTRealSetup> mFFTSetup;
+  index                               mFFTMaxLog2Size{0};
 };
 
 } // namespace algorithm
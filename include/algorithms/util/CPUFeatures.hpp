@@ -0,0 +1,91 @@
+/*
+Part of the Fluid Corpus Manipulation Project (http://www.flucoma.org/)
+Copyright 2017-2019 University of Huddersfield.
+Licensed under the BSD-3 License.
+See license.md file in the project root for full license information.
+This project has received funding from the European Research Council (ERC)
+under the European Union’s Horizon 2020 research and innovation programme
+(grant agreement No 725899).
+*/
+
+/// Run time CPU detection, so that hot kernels can be compiled for several
+/// instruction sets within one build and picked on the machine that runs it
+/// (see VectorKernels.hpp).
+
+#pragma once
+
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) ||            \
+    defined(_M_IX86)
+#define FLUID_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+#endif
+
+// Compiles one function for an instruction set beyond the build's baseline.
+// MSVC allows any intrinsic anywhere, so needs nothing
+#if defined(FLUID_X86) && (defined(__GNUC__) || defined(__clang__))
+#define FLUID_TARGET(isa) __attribute__((target(isa)))
+#else
+#define FLUID_TARGET(isa)
+#endif
+
+namespace fluid {
+namespace algorithm {
+
+enum class SIMDLevel { kScalar, kAVX2, kAVX512 };
+
+namespace impl {
+
+inline SIMDLevel detectSIMDLevel()
+{
+#if defined(FLUID_X86) && (defined(__GNUC__) || defined(__clang__))
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f")) return SIMDLevel::kAVX512;
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+    return SIMDLevel::kAVX2;
+#elif defined(FLUID_X86) && defined(_MSC_VER)
+  int info[4];
+  __cpuid(info, 0);
+  if (info[0] < 7) return SIMDLevel::kScalar;
+  __cpuid(info, 1);
+  bool fma = info[2] & (1 << 12);
+  bool osxsave = info[2] & (1 << 27);
+  if (!osxsave) return SIMDLevel::kScalar;
+  unsigned long long xcr0 = _xgetbv(0);
+  bool               ymm = (xcr0 & 0x6) == 0x6;
+  bool               zmm = (xcr0 & 0xe6) == 0xe6;
+  __cpuidex(info, 7, 0);
+  bool avx2 = info[1] & (1 << 5);
+  bool avx512f = info[1] & (1 << 16);
+  if (avx512f && zmm) return SIMDLevel::kAVX512;
+  if (avx2 && fma && ymm) return SIMDLevel::kAVX2;
+#endif
+  return SIMDLevel::kScalar;
+}
+
+} // namespace impl
+
+/// The best kernel level this CPU supports, decided once. Setting the
+/// environment variable FLUID_SIMD to "scalar" or "avx2" caps it, which helps
+/// when comparing results across machines
+inline SIMDLevel simdLevel()
+{
+  static const SIMDLevel level = [] {
+    SIMDLevel   detected = impl::detectSIMDLevel();
+    const char* cap = std::getenv("FLUID_SIMD");
+    if (!cap) return detected;
+    if (!std::strcmp(cap, "scalar")) return SIMDLevel::kScalar;
+    if (!std::strcmp(cap, "avx2") && detected == SIMDLevel::kAVX512)
+      return SIMDLevel::kAVX2;
+    return detected;
+  }();
+  return level;
+}
+
+} // namespace algorithm
+} // namespace fluid
@@ -11,9 +11,11 @@ under the European Union’s Horizon 2020 research and innovation programme
 #pragma once
 
 #include "AlgorithmUtils.hpp"
+#include "../../data/FluidIndex.hpp"
 #include <Eigen/Core>
 #include <cassert>
 #include <cmath>
+#include <functional>
 #include <map>
 
 namespace fluid {
@@ -84,6 +86,26 @@ public:
        };
     return _funcs;
   }
+
+  // Evaluates the metric directly on Eigen expressions (e.g. rows of a
+  // matrix), avoiding the copies made by calling through map()
+  template <typename DerivedX, typename DerivedY>
+  static double distance(Distance d, const Eigen::ArrayBase<DerivedX>& x,
+                         const Eigen::ArrayBase<DerivedY>& y)
+  {
+    switch (d)
+    {
+    case Distance::kManhattan: return (x - y).abs().sum();
+    case Distance::kEuclidean: return std::sqrt((x - y).square().sum());
+    case Distance::kSqEuclidean: return (x - y).square().sum();
+    case Distance::kMax: return (x - y).abs().maxCoeff();
+    case Distance::kMin: return (x - y).abs().minCoeff();
+    case Distance::kCosine:
+      return 1 - (x.matrix().dot(y.matrix()) /
+                  (x.matrix().norm() * y.matrix().norm()));
+    default: return map()[d](x, y);
+    }
+  }
 };
 
 Eigen::MatrixXd DistanceMatrix(Eigen::Ref<Eigen::MatrixXd> X, index distance)
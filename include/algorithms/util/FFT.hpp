@@ -10,6 +10,7 @@ under the European Union’s Horizon 2020 research and innovation programme
 
 #pragma once
 
+#include "VectorKernels.hpp"
 #include "../../data/FluidIndex.hpp"
 #include <Eigen/Core>
 #include <HISSTools_FFT/HISSTools_FFT.h>
@@ -71,22 +72,59 @@ public:
     mSize = newSize;
   }
 
+  // Views of the split real and imaginary parts of a spectrum
+  struct SplitSpectrum
+  {
+    Eigen::Ref<const ArrayXd> real;
+    Eigen::Ref<const ArrayXd> imag;
+  };
+
   Eigen::Ref<ArrayXcd> process(const ArrayXdRef& input)
+  {
+    transform(input);
+    kernels::interleave(mSplit.realp, mSplit.imagp, 0.5, mOutputBuffer.data(),
+                        mFrameSize);
+    return mOutputBuffer.segment(0, mFrameSize);
+  }
+
+  // The same spectrum as process(), left in the split form the transform
+  // produces, for consumers that want real and imaginary parts apart (e.g.
+  // magnitudes). Valid until the next call
+  SplitSpectrum processSplit(const ArrayXdRef& input)
+  {
+    transform(input);
+    mRealBuffer.segment(0, mFrameSize) *= 0.5;
+    mImagBuffer.segment(0, mFrameSize) *= 0.5;
+    return {mRealBuffer.segment(0, mFrameSize),
+            mImagBuffer.segment(0, mFrameSize)};
+  }
+
+  // Magnitudes of the spectrum process() would return, or with power their
+  // squares, computed from the split transform in one pass
+  void processMagnitude(const ArrayXdRef& input, Eigen::Ref<ArrayXd> out,
+                        bool power = false)
+  {
+    assert(out.size() == mFrameSize);
+    transform(input);
+    auto real = mRealBuffer.head(mFrameSize);
+    auto imag = mImagBuffer.head(mFrameSize);
+    if (power)
+      out = (real.square() + imag.square()) * 0.25;
+    else
+      out = (real.square() + imag.square()).sqrt() * 0.5;
+  }
+
+protected:
+  // HISSTools packs the Nyquist bin into imag[0]; unpack it
+  void transform(const ArrayXdRef& input)
   {
     hisstools_rfft(mSetup, input.data(), &mSplit, asUnsigned(input.size()),
                    asUnsigned(mLog2Size));
     mSplit.realp[mFrameSize - 1] = mSplit.imagp[0];
     mSplit.imagp[mFrameSize - 1] = 0;
     mSplit.imagp[0] = 0;
-    for (index i = 0; i < mFrameSize; i++)
-    {
-      mOutputBuffer(i) =
-          0.5 * std::complex<double>(mSplit.realp[i], mSplit.imagp[i]);
-    }
-    return mOutputBuffer.segment(0, mFrameSize);
   }
 
-protected:
   index mMaxSize{16384};
   index mSize{1024};
   index mFrameSize{513};
@@ -112,18 +150,30 @@ public:
 
   Eigen::Ref<ArrayXd> process(const Eigen::Ref<const ArrayXcd>& input)
   {
-    for (index i = 0; i < input.size(); i++)
-    {
-      mSplit.realp[i] = input[i].real();
-      mSplit.imagp[i] = input[i].imag();
-    }
+    kernels::deinterleave(input.data(), mSplit.realp, mSplit.imagp,
+                          input.size());
+    return inverse();
+  }
+
+  // From split real and imaginary parts, skipping the unpacking
+  Eigen::Ref<ArrayXd> process(const Eigen::Ref<const ArrayXd>& real,
+                              const Eigen::Ref<const ArrayXd>& imag)
+  {
+    assert(real.size() == mFrameSize && imag.size() == mFrameSize);
+    Eigen::Map<ArrayXd>(mSplit.realp, mFrameSize) = real;
+    Eigen::Map<ArrayXd>(mSplit.imagp, mFrameSize) = imag;
+    return inverse();
+  }
+
+private:
+  Eigen::Ref<ArrayXd> inverse()
+  {
     mSplit.imagp[0] = mSplit.realp[mFrameSize - 1];
     hisstools_rifft(mSetup, &mSplit, mOutputBuffer.data(),
                     asUnsigned(mLog2Size));
     return mOutputBuffer.segment(0, mSize);
   }
 
-private:
   ArrayXd mOutputBuffer;
 };
 } // namespace algorithm
@@ -80,51 +80,39 @@ auto asFluid(const PlainObjectBase<Derived>& a)
 /// lvalue FluidTensor<T> / FluidTensorView<T> -> Matrix/Array<T> (say which as
 /// template param) e.g. asEigen<Matrix>(myView)
 
+/// A whole FluidTensor is contiguous, and aligned if its allocator says so,
+/// so it maps without strides and Eigen can use aligned packet loads
+template <typename Allocator>
+constexpr int tensorAlignment()
+{
+  return AllocatorAlignment<Allocator>::value >= EIGEN_MAX_ALIGN_BYTES
+             ? Eigen::AlignedMax
+             : Eigen::Unaligned;
+}
+
 template <template <typename, int, int, int, int, int> class EigenType,
-          typename T, size_t N>
-auto asEigen(FluidTensor<T, N>& a)
+          typename T, size_t N, typename Allocator>
+auto asEigen(FluidTensor<T, N, Allocator>& a)
     -> Map<EigenType<T, Dynamic, Dynamic, RowMajor, Dynamic, Dynamic>,
-           Eigen::AlignmentType::Unaligned, Stride<Dynamic, Dynamic>>
+           tensorAlignment<Allocator>()>
 {
   static_assert(N < 3,
                 "Can't convert to Eigen types with more than two dimensions");
-
-  if (N == 2)
-  {
-    return {a.data(), static_cast<Eigen::Index>(a.rows()),
-            static_cast<Eigen::Index>(a.cols()),
-            Stride<Dynamic, Dynamic>(a.descriptor().strides[0],
-                                     a.descriptor().strides[1])};
-  }
-  else
-  {
-    return {a.data(), static_cast<Eigen::Index>(a.rows()), 1,
-            Stride<Dynamic, Dynamic>(a.descriptor().strides[0], 1)};
-  }
+  return {a.data(), static_cast<Eigen::Index>(a.rows()),
+          static_cast<Eigen::Index>(N == 2 ? a.cols() : 1)};
 }
 
 /// lvalue const FluidTensor<T> -> const Matrix<T>/ const Array<T>
 template <template <typename, int, int, int, int, int> class EigenType,
-          typename T, size_t N>
-auto asEigen(const FluidTensor<T, N>& a)
+          typename T, size_t N, typename Allocator>
+auto asEigen(const FluidTensor<T, N, Allocator>& a)
     -> Map<const EigenType<T, Dynamic, Dynamic, RowMajor, Dynamic, Dynamic>,
-           Eigen::AlignmentType::Unaligned, Stride<Dynamic, Dynamic>>
+           tensorAlignment<Allocator>()>
 {
   static_assert(N < 3,
                 "Can't convert to Eigen types with more than two dimensions");
-
-  if (N == 2)
-  {
-    return {a.data(), static_cast<Eigen::Index>(a.rows()),
-            static_cast<Eigen::Index>(a.cols()),
-            Stride<Dynamic, Dynamic>(a.descriptor().strides[0],
-                                     a.descriptor().strides[1])};
-  }
-  else
-  {
-    return {a.data(), static_cast<Eigen::Index>(a.rows()), 1,
-            Stride<Dynamic, Dynamic>(a.descriptor().strides[0], 1)};
-  }
+  return {a.data(), static_cast<Eigen::Index>(a.rows()),
+          static_cast<Eigen::Index>(N == 2 ? a.cols() : 1)};
 }
 
 
@@ -25,27 +25,29 @@ class Munkres
 {
 public:
   using intPair = std::pair<int, int>;
+
+  // Storage only grows, so repeated init() / process() calls on problems no
+  // larger than the biggest seen so far do not allocate
   void init(index rows, index cols)
   {
     using namespace Eigen;
-    index N = std::max(rows, cols);
-    mCost = ArrayXXd::Zero(N, N);
-    mRowMin = ArrayXd::Zero(N);
-    mColMin = ArrayXd::Zero(N);
-    mMask = ArrayXXi::Zero(N, N);
-    mRowCover = ArrayXi::Zero(N);
-    mColCover = ArrayXi::Zero(N);
-    mPath = ArrayXXi::Zero(2 * N + 1, 2);
+    mN = std::max(rows, cols);
+    if (mCost.rows() < mN)
+    {
+      mCost = ArrayXXd::Zero(mN, mN);
+      mMask = ArrayXXi::Zero(mN, mN);
+      mRowCover = ArrayXi::Zero(mN);
+      mColCover = ArrayXi::Zero(mN);
+      mPath = ArrayXXi::Zero(2 * mN + 1, 2);
+    }
   }
 
   void reset()
   {
-    mCost.setZero();
-    mRowMin.setZero();
-    mColMin.setZero();
-    mMask.setZero();
-    mRowCover.setZero();
-    mColCover.setZero();
+    cost().setZero();
+    mask().setZero();
+    rowCover().setZero();
+    colCover().setZero();
     mPath.setZero();
   }
 
@@ -55,9 +57,8 @@ public:
     bool done;
     reset();
     double maxCost = costMatrix.maxCoeff();
-    mCost = Eigen::ArrayXXd::Ones(mCost.rows(), mCost.cols());
-    mCost = mCost * (10.0 * maxCost);
-    mCost.block(0, 0, costMatrix.rows(), costMatrix.cols()) = costMatrix;
+    cost().setConstant(10.0 * maxCost);
+    cost().topLeftCorner(costMatrix.rows(), costMatrix.cols()) = costMatrix;
     step1();
     step2();
     done = step3();
@@ -73,25 +74,23 @@ public:
       done = step3();
     }
     for (int i = 0; i < result.size(); i++)
-    { mMask.row(i).maxCoeff(&result(i)); }
+    { mask().row(i).maxCoeff(&result(i)); }
   }
 
   void step1()
   {
-    mRowMin = mCost.rowwise().minCoeff();
-    mColMin = (mCost.colwise() - mRowMin).colwise().minCoeff();
-    for (int i = 0; i < mCost.rows(); i++)
+    for (int i = 0; i < mN; i++)
     {
-      double min = mCost.row(i).minCoeff();
-      mCost.row(i) -= min;
+      double min = cost().row(i).minCoeff();
+      cost().row(i) -= min;
     }
   }
 
   void step2()
   {
-    for (int i = 0; i < mCost.rows(); i++)
+    for (int i = 0; i < mN; i++)
     {
-      for (int j = 0; j < mCost.cols(); j++)
+      for (int j = 0; j < mN; j++)
       {
         if (mCost(i, j) == 0 && mRowCover(i) == 0 && mColCover(j) == 0)
         {
@@ -101,21 +100,21 @@ public:
         }
       }
     }
-    mRowCover.setZero();
-    mColCover.setZero();
+    rowCover().setZero();
+    colCover().setZero();
   }
 
   bool step3()
   {
-    for (int i = 0; i < mMask.rows(); i++)
+    for (int i = 0; i < mN; i++)
     {
-      for (int j = 0; j < mMask.cols(); j++)
+      for (int j = 0; j < mN; j++)
       {
         if (mMask(i, j) == 1) { mColCover(j) = 1; }
       }
     }
-    Eigen::Index nCovered = (mColCover == 1).count();
-    return nCovered >= mMask.rows() || nCovered >= mMask.cols();
+    Eigen::Index nCovered = (colCover() == 1).count();
+    return nCovered >= mN;
   }
 
   intPair step4()
@@ -129,8 +128,7 @@ public:
       col = pos.second;
       if (row < 0) { break; }
       mMask(row, col) = 2;
-      Eigen::ArrayXi r = mMask.row(row);
-      int            colStar = findValue(r, 1);
+      int colStar = findInRow(row, 1);
       if (colStar >= 0)
       {
         col = colStar;
@@ -155,31 +153,28 @@ public:
     mPath(pathCount, 1) = Z.second;
     while (true)
     {
-      int            tmp = mPath(pathCount, 1);
-      Eigen::ArrayXi tmpCol = mMask.col(tmp);
-      row = findValue(tmpCol, 1);
+      row = findInCol(mPath(pathCount, 1), 1);
       if (row == -1) break;
       pathCount++;
       mPath(pathCount, 0) = row;
       mPath(pathCount, 1) = mPath(pathCount - 1, 1);
-      Eigen::ArrayXi r = mMask.row(mPath(pathCount, 0));
-      col = findValue(r, 2);
+      col = findInRow(mPath(pathCount, 0), 2);
       pathCount++;
       mPath(pathCount, 0) = mPath(pathCount - 1, 0);
       mPath(pathCount, 1) = col;
     }
     augmentPath(pathCount);
-    mRowCover.setZero();
-    mColCover.setZero();
+    rowCover().setZero();
+    colCover().setZero();
     erasePrimes();
   }
 
   void step6()
   {
     double m = minCost();
-    for (int i = 0; i < mCost.rows(); i++)
+    for (int i = 0; i < mN; i++)
     {
-      for (int j = 0; j < mCost.cols(); j++)
+      for (int j = 0; j < mN; j++)
       {
         if (mRowCover(i) == 1) mCost(i, j) += m;
         if (mColCover(j) == 0) mCost(i, j) -= m;
@@ -190,9 +185,9 @@ public:
   double minCost()
   {
     double minVal = std::numeric_limits<double>::max();
-    for (int i = 0; i < mCost.rows(); i++)
+    for (int i = 0; i < mN; i++)
     {
-      for (int j = 0; j < mCost.cols(); j++)
+      for (int j = 0; j < mN; j++)
       {
         if (mRowCover(i) == 0 && mColCover(j) == 0)
         {
@@ -206,9 +201,9 @@ public:
 
   void erasePrimes()
   {
-    for (int i = 0; i < mMask.rows(); i++)
+    for (int i = 0; i < mN; i++)
     {
-      for (int j = 0; j < mMask.cols(); j++)
+      for (int j = 0; j < mN; j++)
       {
         if (mMask(i, j) == 2) { mMask(i, j) = 0; }
       }
@@ -217,8 +212,8 @@ public:
 
   intPair findZero()
   {
-    for (int i = 0; i < mCost.rows(); i++)
-      for (int j = 0; j < mCost.cols(); j++)
+    for (int i = 0; i < mN; i++)
+      for (int j = 0; j < mN; j++)
       {
         if (mCost(i, j) == 0 && mRowCover(i) == 0 && mColCover(j) == 0)
           return std::make_pair(i, j);
@@ -226,11 +221,20 @@ public:
     return std::make_pair(-1, -1);
   }
 
-  int findValue(Eigen::Ref<const Eigen::ArrayXi> vector, const int val)
+  int findInRow(index row, const int val)
+  {
+    for (int j = 0; j < mN; j++)
+    {
+      if (mMask(row, j) == val) return j;
+    }
+    return -1;
+  }
+
+  int findInCol(index col, const int val)
   {
-    for (int i = 0; i < vector.size(); i++)
+    for (int i = 0; i < mN; i++)
     {
-      if (vector(i) == val) return i;
+      if (mMask(i, col) == val) return i;
     }
     return -1;
   }
@@ -245,9 +249,13 @@ public:
   }
 
 private:
+  Eigen::Block<Eigen::ArrayXXd> cost() { return mCost.topLeftCorner(mN, mN); }
+  Eigen::Block<Eigen::ArrayXXi> mask() { return mMask.topLeftCorner(mN, mN); }
+  Eigen::VectorBlock<Eigen::ArrayXi> rowCover() { return mRowCover.head(mN); }
+  Eigen::VectorBlock<Eigen::ArrayXi> colCover() { return mColCover.head(mN); }
+
+  index           mN{0};
   Eigen::ArrayXXd mCost;
-  Eigen::ArrayXd  mRowMin;
-  Eigen::ArrayXd  mColMin;
   Eigen::ArrayXXi mMask;
   Eigen::ArrayXXi mPath;
   Eigen::ArrayXi  mRowCover;
@@ -15,11 +15,17 @@ under the European Union’s Horizon 2020 research and innovation programme
 #include "../public/WindowFuncs.hpp"
 #include "../../data/FluidIndex.hpp"
 #include <Eigen/Core>
+#include <cmath>
 
 namespace fluid {
 namespace algorithm {
 
 // This implements Foote's novelty curve
+// Frames and their similarities are kept in rings indexed by slot, so each
+// hop only writes the new frame's similarity row / column. The Gaussian
+// checkerboard kernel is separable (w * w^T, with w a Gaussian whose second
+// half is negated), so the kernel correlation is the quadratic form
+// w^T S w, evaluated with w rotated to line up with the ring
 class Novelty
 {
 
@@ -29,61 +35,80 @@ public:
   using MatrixXd = Eigen::MatrixXd;
   using VectorXd = Eigen::VectorXd;
 
-  Novelty(index maxSize) : mKernelStorage(maxSize, maxSize) {}
+  Novelty(index maxSize)
+      : mSimilarityStorage(maxSize, maxSize), mWeightStorage(maxSize),
+        mRotatedWeightStorage(maxSize), mNormStorage(maxSize),
+        mRowStorage(maxSize), mProductStorage(maxSize)
+  {}
 
   void init(index kernelSize, index nDims)
   {
     assert(kernelSize % 2);
+    assert(kernelSize <= mSimilarityStorage.rows());
     mKernelSize = kernelSize;
     mNDims = nDims;
     createKernel();
-    mSimilarity = MatrixXd::Zero(mKernelSize, mKernelSize);
-    mBufer = MatrixXd::Zero(mKernelSize, nDims);
+    similarity().setZero();
+    mNormStorage.head(mKernelSize).setConstant(epsilon);
+    mBuffer = MatrixXd::Zero(mKernelSize, nDims);
+    mHead = 0;
   }
 
-  double processFrame(const ArrayXd& input)
+  double processFrame(const Eigen::Ref<const ArrayXd>& input)
   {
-    using std::vector;
-    mBufer.block(0, 0, mKernelSize - 1, mNDims) =
-        mBufer.block(1, 0, mKernelSize - 1, mNDims);
-    ArrayXXd x = mBufer.block(mKernelSize - 1, 0, 1, mNDims);
-    VectorXd in1 = input.matrix();
-    mBufer.block(mKernelSize - 1, 0, 1, mNDims) = in1.transpose();
-    VectorXd tmp = mBufer * input.matrix();
-    VectorXd norm =
-        mBufer.rowwise().norm().cwiseMax(epsilon) * input.matrix().norm();
-    norm = norm.cwiseMax(epsilon);
-    tmp = (tmp.array() / norm.array()).matrix();
-    mSimilarity.block(0, 0, mKernelSize - 1, mKernelSize - 1) =
-        mSimilarity.block(1, 1, mKernelSize - 1, mKernelSize - 1);
-    ArrayXXd x1 = mSimilarity.block(0, mKernelSize - 1, mKernelSize, 1);
-    mSimilarity.block(0, mKernelSize - 1, mKernelSize, 1) = tmp;
-    mSimilarity.block(mKernelSize - 1, 0, 1, mKernelSize) = tmp.transpose();
-    double result = (mSimilarity.array() * mKernel).sum();
-    return result / mNorm;
+    // the new frame overwrites the oldest slot
+    index  newest = mHead;
+    double inputNorm = input.matrix().norm();
+    mHead = (mHead + 1) % mKernelSize;
+
+    auto norms = mNormStorage.head(mKernelSize);
+    auto row = mRowStorage.head(mKernelSize);
+    mBuffer.row(newest) = input.matrix().transpose();
+    norms(newest) = std::max(inputNorm, epsilon);
+    row.noalias() = mBuffer * input.matrix();
+    row.array() /= (norms.array() * inputNorm).max(epsilon);
+    similarity().col(newest) = row;
+    similarity().row(newest) = row.transpose();
+
+    // window position a lives in slot (mHead + a) % mKernelSize
+    auto  weights = mWeightStorage.head(mKernelSize);
+    auto  rotated = mRotatedWeightStorage.head(mKernelSize);
+    auto  product = mProductStorage.head(mKernelSize);
+    index nWrapped = mKernelSize - mHead;
+    rotated.segment(mHead, nWrapped) = weights.head(nWrapped);
+    rotated.head(mHead) = weights.tail(mHead);
+    product.noalias() = similarity() * rotated;
+    return rotated.dot(product) / mNorm;
   }
 
 private:
+  Eigen::Block<MatrixXd> similarity()
+  {
+    return mSimilarityStorage.topLeftCorner(mKernelSize, mKernelSize);
+  }
+
   void createKernel()
   {
-    mKernel = mKernelStorage.block(0, 0, mKernelSize, mKernelSize);
     index   h = (mKernelSize - 1) / 2;
     ArrayXd gaussian = ArrayXd::Zero(mKernelSize);
     WindowFuncs::map()[WindowFuncs::WindowTypes::kGaussian](mKernelSize,
                                                             gaussian);
-    MatrixXd tmp = gaussian.matrix() * gaussian.matrix().transpose();
-    tmp.block(h, 0, h + 1, h) *= -1;
-    tmp.block(0, h, h, h + 1) *= -1;
-    mKernel = tmp.array();
-    mNorm = mKernel.square().sum();
+    auto weights = mWeightStorage.head(mKernelSize);
+    weights = gaussian.matrix();
+    weights.tail(mKernelSize - h) *= -1;
+    mNorm = std::pow(weights.squaredNorm(), 2);
   }
 
   index    mKernelSize{3};
   index    mNDims{513};
-  ArrayXXd mKernel;
-  ArrayXXd mKernelStorage;
-  MatrixXd mSimilarity;
-  MatrixXd mBufer;
+  index    mHead{0};
+  MatrixXd mSimilarityStorage;
+  VectorXd mWeightStorage;
+  VectorXd mRotatedWeightStorage;
+  VectorXd mNormStorage;
+  VectorXd mRowStorage;
+  VectorXd mProductStorage;
+  MatrixXd mBuffer;
   double   mNorm{1.};
 };
 } // namespace algorithm
@@ -0,0 +1,186 @@
+/*
+Part of the Fluid Corpus Manipulation Project (http://www.flucoma.org/)
+Copyright 2017-2019 University of Huddersfield.
+Licensed under the BSD-3 License.
+See license.md file in the project root for full license information.
+This project has received funding from the European Research Council (ERC)
+under the European Union’s Horizon 2020 research and innovation programme
+(grant agreement No 725899).
+*/
+
+#pragma once
+
+#include "../../data/FluidIndex.hpp"
+#include <Eigen/Core>
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <functional>
+
+namespace fluid {
+namespace algorithm {
+
+// Quantiles by selection rather than sorting. Several ranks are found in one
+// recursive pass: each nth_element splits the range and the remaining ranks
+// go to whichever side holds them, so k quantiles cost O(n log k)
+class OrderStatistics
+{
+public:
+  using ArrayXd = Eigen::ArrayXd;
+  using ArrayXi = Eigen::ArrayXi;
+
+  static constexpr index kMaxQuantiles = 8;
+
+  // Reorders [first, first + size) so that each of the requested ranks holds
+  // the element a full sort would put there
+  template <typename RandomIt, typename Compare>
+  static void select(RandomIt first, index size, const index* ranks,
+                     index numRanks, Compare comp)
+  {
+    assert(numRanks <= kMaxQuantiles);
+    index sorted[kMaxQuantiles];
+    std::copy(ranks, ranks + numRanks, sorted);
+    std::sort(sorted, sorted + numRanks);
+    index* last = std::unique(sorted, sorted + numRanks);
+    selectSorted(first, 0, size, sorted, last, comp);
+  }
+
+  // Nearest-rank quantiles, i.e. the sorted element at lrint(q * (n - 1)).
+  // data is used as scratch space and is left partially ordered
+  static void quantiles(Eigen::Ref<ArrayXd> data, const double* q, double* out,
+                        index numQuantiles)
+  {
+    index length = data.size();
+    index ranks[kMaxQuantiles];
+    assert(numQuantiles <= kMaxQuantiles);
+    for (index i = 0; i < numQuantiles; i++)
+      ranks[i] = std::lrint(q[i] * (length - 1));
+    select(data.data(), length, ranks, numQuantiles, std::less<double>());
+    for (index i = 0; i < numQuantiles; i++) out[i] = data(ranks[i]);
+  }
+
+  // Weighted quantiles over normalised weights. For each fraction q, finds the
+  // first sorted position i >= 1 whose cumulative weight reaches q and
+  // returns whichever of elements i - 1 and i has the cumulative weight
+  // closer to q (the earlier one on a tie if inclusive[j] is set), taking the
+  // cumulative weight before position 1 as zero. Fractions that are never
+  // reached return the element at sorted rank fallbackRanks[j] instead.
+  // perm is scratch space
+  static void weightedQuantiles(Eigen::Ref<const ArrayXd> values,
+                                Eigen::Ref<const ArrayXd> weights,
+                                Eigen::Ref<ArrayXi> perm, const double* q,
+                                const bool*  inclusive,
+                                const index* fallbackRanks, double* out,
+                                index numQuantiles)
+  {
+    index length = values.size();
+    assert(numQuantiles <= kMaxQuantiles);
+    for (index i = 0; i < length; i++) perm(i) = static_cast<int>(i);
+    auto comp = [&values](int a, int b) { return values(a) < values(b); };
+
+    index  order[kMaxQuantiles];
+    index  positions[kMaxQuantiles];
+    double targets[kMaxQuantiles];
+    for (index i = 0; i < numQuantiles; i++) order[i] = i;
+    std::sort(order, order + numQuantiles,
+              [q](index a, index b) { return q[a] < q[b]; });
+    for (index i = 0; i < numQuantiles; i++) targets[i] = q[order[i]];
+
+    weightedSelect(perm.data(), weights, 0, length, 0.0, targets,
+                   targets + numQuantiles, positions, comp);
+
+    bool needFallback = false;
+    for (index j = 0; j < numQuantiles; j++)
+    {
+      index pos = positions[j];
+      if (pos < 0 || length < 2)
+      {
+        positions[j] = -1;
+        needFallback = true;
+        continue;
+      }
+      // a hit on the smallest element (perm(0), once selected) moves on to
+      // the second smallest, found by scanning so other positions survive
+      int current = perm(pos);
+      if (pos == 0)
+      {
+        index next = 1;
+        for (index i = 2; i < length; i++)
+          if (values(perm(i)) < values(perm(next))) next = i;
+        current = perm(next);
+        pos = 1;
+      }
+      double below = 0;
+      int    previous = perm(0);
+      for (index i = 0; i < pos; i++)
+      {
+        below += weights(perm(i));
+        if (values(perm(i)) > values(previous)) previous = perm(i);
+      }
+      double acc = below + weights(current);
+      double prevAcc = pos == 1 ? 0 : below;
+      double t = targets[j];
+      double dPrevious = std::abs(prevAcc - t), dCurrent = std::abs(acc - t);
+      bool   usePrevious = inclusive[order[j]] ? dPrevious <= dCurrent
+                                               : dPrevious < dCurrent;
+      out[order[j]] = usePrevious ? values(previous) : values(current);
+    }
+
+    if (!needFallback) return;
+    for (index j = 0; j < numQuantiles; j++)
+    {
+      if (positions[j] >= 0) continue;
+      index rank = fallbackRanks[order[j]];
+      std::nth_element(perm.data(), perm.data() + rank, perm.data() + length,
+                       comp);
+      out[order[j]] = values(perm(rank));
+    }
+  }
+
+private:
+  template <typename RandomIt, typename Compare>
+  static void selectSorted(RandomIt first, index lo, index hi,
+                           const index* ranksBegin, const index* ranksEnd,
+                           Compare comp)
+  {
+    if (ranksBegin == ranksEnd || hi - lo < 2) return;
+    const index* pivot = ranksBegin + (ranksEnd - ranksBegin) / 2;
+    std::nth_element(first + lo, first + *pivot, first + hi, comp);
+    selectSorted(first, lo, *pivot, ranksBegin, pivot, comp);
+    selectSorted(first, *pivot + 1, hi, pivot + 1, ranksEnd, comp);
+  }
+
+  // For ascending targets, finds in perm[lo, hi) the first position whose
+  // cumulative weight (starting from base) reaches each target, or -1
+  template <typename Compare>
+  static void weightedSelect(int* perm, Eigen::Ref<const ArrayXd> weights,
+                             index lo, index hi, double base,
+                             const double* targetsBegin,
+                             const double* targetsEnd, index* positions,
+                             Compare comp)
+  {
+    if (targetsBegin == targetsEnd) return;
+    if (lo >= hi)
+    {
+      std::fill(positions, positions + (targetsEnd - targetsBegin), -1);
+      return;
+    }
+    index mid = lo + (hi - lo) / 2;
+    std::nth_element(perm + lo, perm + mid, perm + hi, comp);
+    double atMid = base;
+    for (index i = lo; i <= mid; i++) atMid += weights(perm[i]);
+    const double* split = std::upper_bound(targetsBegin, targetsEnd, atMid);
+    index         numLeft = split - targetsBegin;
+
+    // targets reached by mid lie in [lo, mid]: search [lo, mid) first
+    weightedSelect(perm, weights, lo, mid, base, targetsBegin, split,
+                   positions, comp);
+    for (index i = 0; i < numLeft; i++)
+      if (positions[i] < 0) positions[i] = mid;
+
+    weightedSelect(perm, weights, mid + 1, hi, atMid, split, targetsEnd,
+                   positions + numLeft, comp);
+  }
+};
+} // namespace algorithm
+} // namespace fluid
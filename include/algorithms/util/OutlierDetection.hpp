@@ -11,6 +11,7 @@ under the European Union’s Horizon 2020 research and innovation programme
 #pragma once
 
 #include "FluidEigenMappings.hpp"
+#include "OrderStatistics.hpp"
 #include "../../data/FluidIndex.hpp"
 #include "../../data/FluidTensor.hpp"
 #include <Eigen/Core>
@@ -26,23 +27,27 @@ class OutlierDetection
   using ArrayXi = Eigen::ArrayXi;
 
 public:
+  // Zeroes the mask for values further than k interquartile ranges outside
+  // the quartiles (k >= 0)
   void process(Eigen::Ref<const ArrayXd> input, Eigen::Ref<Eigen::ArrayXi> mask,
                double k)
   {
-    index   length = input.size();
-    ArrayXi perm = ArrayXi::LinSpaced(length, 0, length - 1);
-    std::sort(perm.data(), perm.data() + length,
-              [&](size_t i, size_t j) { return input(i) < input(j); });
-    index  q1 = lrint(0.25 * (length - 1));
-    index  q3 = lrint(0.75 * (length - 1));
-    double margin = k * (input(perm(q3)) - input(perm(q1)));
-    double lowerBound = input(perm(q1)) - margin;
-    double upperBound = input(perm(q3)) + margin;
-    for (index i = 0; input(perm(i)) < lowerBound && i <= q1; i++)
-    { mask(perm(i)) = 0; }
-    for (index i = length - 1; input(perm(i)) > upperBound && i >= q3; i--)
-    { mask(perm(i)) = 0; }
+    index  length = input.size();
+    double fractions[] = {0.25, 0.75};
+    double quartiles[2];
+    mScratch = input;
+    OrderStatistics::quantiles(mScratch, fractions, quartiles, 2);
+    double margin = k * (quartiles[1] - quartiles[0]);
+    double lowerBound = quartiles[0] - margin;
+    double upperBound = quartiles[1] + margin;
+    for (index i = 0; i < length; i++)
+    {
+      if (input(i) < lowerBound || input(i) > upperBound) mask(i) = 0;
+    }
   }
+
+private:
+  ArrayXd mScratch;
 };
 } // namespace algorithm
 } // namespace fluid
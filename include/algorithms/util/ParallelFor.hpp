@@ -0,0 +1,83 @@
+/*
+Part of the Fluid Corpus Manipulation Project (http://www.flucoma.org/)
+Copyright 2017-2019 University of Huddersfield.
+Licensed under the BSD-3 License.
+See license.md file in the project root for full license information.
+This project has received funding from the European Research Council (ERC)
+under the European Union’s Horizon 2020 research and innovation programme
+(grant agreement No 725899).
+*/
+
+#pragma once
+
+#include "../../data/FluidIndex.hpp"
+#include <algorithm>
+#include <exception>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace fluid {
+namespace algorithm {
+
+// How many workers to split count items over, so that each gets at least
+// minPerWorker of them; maxWorkers <= 0 means one per hardware thread
+inline index numWorkers(index count, index minPerWorker, index maxWorkers = 0)
+{
+  index available =
+      std::max<index>(1, static_cast<index>(std::thread::hardware_concurrency()));
+  if (maxWorkers > 0) available = std::min(available, maxWorkers);
+  return std::max<index>(
+      1, std::min(available, count / std::max<index>(1, minPerWorker)));
+}
+
+// Calls body(begin, end, worker) on contiguous chunks of [0, count), one per
+// worker. The calling thread runs the first chunk, so with a single worker
+// nothing is spawned, and any chunk whose thread can't be started. An
+// exception from body is rethrown once every chunk has finished; if several
+// throw, the one from the lowest chunk wins
+template <typename Body>
+void parallelFor(index count, index workers, Body&& body)
+{
+  workers = std::max<index>(1, std::min(workers, count));
+  if (workers == 1)
+  {
+    body(index(0), count, index(0));
+    return;
+  }
+  std::vector<std::exception_ptr> errors(asUnsigned(workers));
+  auto run = [&body, &errors](index begin, index end, index w) {
+    try
+    {
+      body(begin, end, w);
+    }
+    catch (...)
+    {
+      errors[asUnsigned(w)] = std::current_exception();
+    }
+  };
+  std::vector<std::thread> threads;
+  threads.reserve(asUnsigned(workers - 1));
+  index chunk = count / workers, remainder = count % workers;
+  index begin = chunk + (remainder > 0);
+  for (index w = 1; w < workers; w++)
+  {
+    index end = begin + chunk + (w < remainder);
+    try
+    {
+      threads.emplace_back([&run, begin, end, w]() { run(begin, end, w); });
+    }
+    catch (const std::system_error&)
+    {
+      run(begin, end, w);
+    }
+    begin = end;
+  }
+  run(index(0), chunk + (remainder > 0), index(0));
+  for (auto& t : threads) t.join();
+  for (auto& e : errors)
+    if (e) std::rethrow_exception(e);
+}
+
+} // namespace algorithm
+} // namespace fluid
@@ -15,11 +15,15 @@ Capability through Linear Programming". Proceedings of DAFx-2018.
 
 #pragma once
 
+#include "AlgorithmUtils.hpp"
 #include "Munkres.hpp"
 #include "../../data/FluidIndex.hpp"
 #include <Eigen/Core>
+#include <algorithm>
 #include <cmath>
-#include <queue>
+#include <numeric>
+#include <tuple>
+#include <vector>
 
 namespace fluid {
 namespace algorithm {
@@ -42,9 +46,14 @@ struct SineTrack
   index trackId;
 };
 
+// mTracks is kept ordered by trackId (ids only ever increase and are appended
+// in order, and prune() preserves order), which also orders it by startFrame.
+// Both orderings are used below to index tracks without full scans
 class PartialTracking
 {
   using ArrayXd = Eigen::ArrayXd;
+  using ArrayXXd = Eigen::ArrayXXd;
+  using ArrayXi = Eigen::ArrayXi;
   template <typename T>
   using vector = std::vector<T>;
 
@@ -67,9 +76,10 @@ public:
 
   index minTrackLength() { return mMinTrackLength; }
 
-  void processFrame(vector<SinePeak> peaks, double maxAmp, index minTrackLength,
-                    double birthLowThreshold, double birthHighThreshold,
-                    index method, double zetaA, double zetaF, double delta)
+  void processFrame(const vector<SinePeak>& peaks, double maxAmp,
+                    index minTrackLength, double birthLowThreshold,
+                    double birthHighThreshold, index method, double zetaA,
+                    double zetaF, double delta)
   {
     assert(mInitialized);
     mMinTrackLength = minTrackLength;
@@ -83,32 +93,39 @@ public:
       mDelta = delta;
       updateVariances();
     }
+    mPeaks.assign(peaks.begin(), peaks.end());
     if (method == 0)
-      assignGreedy(peaks, maxAmp);
+      assignGreedy(maxAmp);
     else
-      assignMunkres(peaks, maxAmp);
+      assignMunkres(maxAmp);
     mCurrentFrame++;
   }
 
   void prune()
   {
-    auto iterator =
-        std::remove_if(mTracks.begin(), mTracks.end(), [&](SineTrack track) {
-          return (track.endFrame >= 0 &&
-                  track.endFrame <= mCurrentFrame - mMinTrackLength);
+    index lastFrame = mCurrentFrame - mMinTrackLength;
+    auto  iterator = std::remove_if(
+        mTracks.begin(), mTracks.end(), [lastFrame](const SineTrack& track) {
+          return (track.endFrame >= 0 && track.endFrame <= lastFrame);
         });
     mTracks.erase(iterator, mTracks.end());
   }
 
-
   vector<SinePeak> getActivePeaks()
   {
     vector<SinePeak> sinePeaks;
-    index            latencyFrame = mCurrentFrame - mMinTrackLength;
-    if (latencyFrame < 0) return sinePeaks;
+    getActivePeaks(sinePeaks);
+    return sinePeaks;
+  }
+
+  void getActivePeaks(vector<SinePeak>& sinePeaks)
+  {
+    sinePeaks.clear();
+    index latencyFrame = mCurrentFrame - mMinTrackLength;
+    if (latencyFrame < 0) return;
     for (auto&& track : mTracks)
     {
-      if (track.startFrame > latencyFrame) continue;
+      if (track.startFrame > latencyFrame) break;
       if (track.endFrame >= 0 && track.endFrame <= latencyFrame) continue;
       if (track.endFrame >= 0 &&
           track.endFrame - track.startFrame < mMinTrackLength)
@@ -116,7 +133,6 @@ public:
       sinePeaks.push_back(
           track.peaks[asUnsigned(latencyFrame - track.startFrame)]);
     }
-    return sinePeaks;
   }
 
 private:
@@ -125,108 +141,209 @@ private:
     using namespace std;
     mVarA = -pow(mZetaA, 2) * log((mDelta - 1) / (mDelta - 2));
     mVarF = -pow(mZetaF, 2) * log((mDelta - 1) / (mDelta - 2));
+    // a pairing is useful when its cost is below 1 / (2 - delta); the
+    // frequency term alone rules that out beyond this (squared) distance
+    mGateF = -mVarF * log(1 - 1 / (2 - mDelta));
+    if (!(mGateF > 0) || !std::isfinite(mGateF)) mGateF = infinity;
   }
 
-  void assignMunkres(vector<SinePeak> sinePeaks, double maxAmp)
+  double usefulCost(const SinePeak& a, const SinePeak& b)
   {
-    using namespace Eigen;
-    using namespace std;
+    return 1 - std::exp(-std::pow(a.freq - b.freq, 2) / mVarF -
+                        std::pow(a.logMag - b.logMag, 2) / mVarA);
+  }
 
-    typedef Array<bool, Dynamic, Dynamic> ArrayXXb;
-    for (auto&& track : mTracks) { track.assigned = false; }
+  bool isUseful(double cost) { return cost < (1 - (1 - mDelta) * cost); }
 
-    if (mPrevPeaks.empty())
+  bool outsideGate(double freq1, double freq2)
+  {
+    return (freq1 - freq2) * (freq1 - freq2) >= mGateF;
+  }
+
+  void sortByFreq(const vector<SinePeak>& peaks, vector<index>& order)
+  {
+    order.resize(peaks.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&peaks](index a, index b) {
+      return peaks[asUnsigned(a)].freq < peaks[asUnsigned(b)].freq;
+    });
+  }
+
+  SineTrack* findTrack(index trackId)
+  {
+    auto it = std::lower_bound(
+        mTracks.begin(), mTracks.end(), trackId,
+        [](const SineTrack& t, index id) { return t.trackId < id; });
+    return (it != mTracks.end() && it->trackId == trackId) ? &*it : nullptr;
+  }
+
+  index findRoot(index node)
+  {
+    while (mParent[asUnsigned(node)] != node)
     {
-      mPrevPeaks = sinePeaks;
-      mPrevTracks = vector<index>(sinePeaks.size(), 0);
-      return;
+      mParent[asUnsigned(node)] =
+          mParent[asUnsigned(mParent[asUnsigned(node)])];
+      node = mParent[asUnsigned(node)];
     }
+    return node;
+  }
 
-    index         N = asSigned(mPrevPeaks.size());
-    index         M = asSigned(sinePeaks.size());
-    ArrayXd       peakFreqs(M);
-    ArrayXd       peakAmps(M);
-    ArrayXd       prevFreqs(N);
-    ArrayXd       prevAmps(N);
-    vector<index> trackAssignment(asUnsigned(M), -1);
-    if (sinePeaks.size() > 0)
+  // Match previous peaks (rows) to current peaks (columns). Only pairs within
+  // the frequency gate that are useful are linked; linked rows and columns
+  // form small independent components, each solved with Munkres. Rows without
+  // a useful match are left unassigned (-1) in mRowAssignment
+  void solveAssignment()
+  {
+    index N = asSigned(mPrevPeaks.size());
+    index M = asSigned(mPeaks.size());
+
+    mRowAssignment.assign(asUnsigned(N), -1);
+    mParent.resize(asUnsigned(N + M));
+    std::iota(mParent.begin(), mParent.end(), 0);
+    mComponentSize.assign(asUnsigned(N + M), 0);
+
+    // sweep both lists in frequency order to find candidate pairs
+    sortByFreq(mPrevPeaks, mPrevOrder);
+    sortByFreq(mPeaks, mPeakOrder);
+    index start = 0;
+    for (index j : mPeakOrder)
     {
-      for (index i = 0; i < M; i++)
+      const SinePeak& peak = mPeaks[asUnsigned(j)];
+      while (start < N &&
+             mPrevPeaks[asUnsigned(mPrevOrder[asUnsigned(start)])].freq <
+                 peak.freq &&
+             outsideGate(
+                 mPrevPeaks[asUnsigned(mPrevOrder[asUnsigned(start)])].freq,
+                 peak.freq))
+        start++;
+      for (index k = start; k < N; k++)
       {
-        peakFreqs(i) = sinePeaks[asUnsigned(i)].freq;
-        peakAmps(i) = sinePeaks[asUnsigned(i)].logMag;
+        index           i = mPrevOrder[asUnsigned(k)];
+        const SinePeak& prev = mPrevPeaks[asUnsigned(i)];
+        if (prev.freq > peak.freq && outsideGate(prev.freq, peak.freq)) break;
+        if (!isUseful(usefulCost(prev, peak))) continue;
+        index a = findRoot(i), b = findRoot(N + j);
+        if (a != b) mParent[asUnsigned(a)] = b;
       }
-      for (index i = 0; i < N; i++)
-      {
-        prevFreqs(i) = mPrevPeaks[asUnsigned(i)].freq;
-        prevAmps(i) = mPrevPeaks[asUnsigned(i)].logMag;
-      }
-      ArrayXXd deltaF = ArrayXXd::Zero(N, M);
-      deltaF.colwise() = prevFreqs;
-      for (index i = 0; i < N; i++) { deltaF.row(i) -= peakFreqs; }
-      ArrayXXd deltaA = ArrayXXd::Zero(N, M);
-      deltaA.colwise() = prevAmps;
-      for (index i = 0; i < N; i++) { deltaA.row(i) -= peakAmps; }
-
-      ArrayXXd usefulCost =
-          1 - (-deltaF.square() / mVarF - deltaA.square() / mVarA).exp();
-      ArrayXXd spuriousCost = 1 - (1 - mDelta) * usefulCost;
-      ArrayXXd cost(N, M);
-      ArrayXXb useful(N, M);
-      for (index i = 0; i < N; i++)
+    }
+
+    // group linked nodes by component (rows sort before columns)
+    mRoots.resize(asUnsigned(N + M));
+    mNodes.clear();
+    for (index n = 0; n < N + M; n++)
+    {
+      mRoots[asUnsigned(n)] = findRoot(n);
+      mComponentSize[asUnsigned(mRoots[asUnsigned(n)])]++;
+    }
+    for (index n = 0; n < N + M; n++)
+      if (mComponentSize[asUnsigned(mRoots[asUnsigned(n)])] > 1)
+        mNodes.push_back(n);
+    std::sort(mNodes.begin(), mNodes.end(), [this](index a, index b) {
+      index rootA = mRoots[asUnsigned(a)], rootB = mRoots[asUnsigned(b)];
+      return rootA < rootB || (rootA == rootB && a < b);
+    });
+
+    for (index begin = 0, size = asSigned(mNodes.size()); begin < size;)
+    {
+      index root = mRoots[asUnsigned(mNodes[asUnsigned(begin)])];
+      index end = begin, split = begin;
+      while (end < size && mRoots[asUnsigned(mNodes[asUnsigned(end)])] == root)
+        if (mNodes[asUnsigned(end++)] < N) split = end;
+      solveComponent(begin, split, end);
+      begin = end;
+    }
+  }
+
+  // Each row may also stay unmatched at the cost of a spurious pairing with a
+  // distant peak (delta), which is what gated-out candidates would cost
+  void solveComponent(index rowsBegin, index colsBegin, index end)
+  {
+    index N = asSigned(mPrevPeaks.size());
+    index nRows = colsBegin - rowsBegin;
+    index nCols = end - colsBegin;
+
+    if (mCost.rows() < nRows || mCost.cols() < nCols + nRows)
+    {
+      mCost.resize(std::max(nRows, mCost.rows()),
+                   std::max(nCols + nRows, mCost.cols()));
+    }
+    if (mAssignment.size() < nRows) mAssignment.resize(nRows);
+
+    for (index r = 0; r < nRows; r++)
+    {
+      const SinePeak& prev =
+          mPrevPeaks[asUnsigned(mNodes[asUnsigned(rowsBegin + r)])];
+      for (index c = 0; c < nCols; c++)
       {
-        for (index j = 0; j < M; j++)
-        {
-          if (usefulCost(i, j) < spuriousCost(i, j))
-          {
-            cost(i, j) = std::abs(usefulCost(i, j));
-            useful(i, j) = true;
-          }
-          else
-          {
-            cost(i, j) = spuriousCost(i, j);
-            useful(i, j) = false;
-          }
-        }
+        const SinePeak& peak =
+            mPeaks[asUnsigned(mNodes[asUnsigned(colsBegin + c)] - N)];
+        double useful = usefulCost(prev, peak);
+        double spurious = 1 - (1 - mDelta) * useful;
+        mCost(r, c) = useful < spurious ? std::abs(useful) : spurious;
       }
-      ArrayXi assignment(N);
-      mMunkres.init(N, M);
-      mMunkres.process(cost, assignment);
+    }
+    mCost.block(0, nCols, nRows, nRows).setConstant(mDelta);
+
+    mMunkres.init(nRows, nCols + nRows);
+    mMunkres.process(mCost.topLeftCorner(nRows, nCols + nRows),
+                     mAssignment.head(nRows));
+
+    for (index r = 0; r < nRows; r++)
+    {
+      index c = mAssignment(r);
+      if (c >= nCols) continue;
+      index i = mNodes[asUnsigned(rowsBegin + r)];
+      index j = mNodes[asUnsigned(colsBegin + c)] - N;
+      if (isUseful(usefulCost(mPrevPeaks[asUnsigned(i)], mPeaks[asUnsigned(j)])))
+        mRowAssignment[asUnsigned(i)] = j;
+    }
+  }
+
+  void assignMunkres(double maxAmp)
+  {
+    using namespace std;
+
+    for (auto&& track : mTracks) { track.assigned = false; }
+
+    if (mPrevPeaks.empty())
+    {
+      swap(mPrevPeaks, mPeaks);
+      mPrevTracks.assign(mPrevPeaks.size(), 0);
+      return;
+    }
+
+    index N = asSigned(mPrevPeaks.size());
+    index M = asSigned(mPeaks.size());
+    mTrackAssignment.assign(asUnsigned(M), -1);
+    if (M > 0)
+    {
+      solveAssignment();
       for (index i = 0; i < N; i++)
       {
-        index p = assignment(i);
-        bool  aboveBirthThreshold =
-            mPrevPeaks[asUnsigned(i)].logMag >
-            birthThreshold(mPrevPeaks[asUnsigned(i)], mPrevMaxAmp);
-        if (assignment(i) >= useful.cols()) continue;
-        if (useful(i, assignment(i)) && mPrevTracks[asUnsigned(i)] > 0 &&
-            mPrevPeaks[asUnsigned(i)].assigned)
+        index p = mRowAssignment[asUnsigned(i)];
+        if (p < 0) continue;
+        SinePeak& prev = mPrevPeaks[asUnsigned(i)];
+        bool aboveBirthThreshold =
+            prev.logMag > birthThreshold(prev, mPrevMaxAmp);
+        if (mPrevTracks[asUnsigned(i)] > 0 && prev.assigned)
         {
-          for (auto& t : mTracks)
+          SineTrack* t = findTrack(mPrevTracks[asUnsigned(i)]);
+          if (t)
           {
-            if (t.trackId == mPrevTracks[asUnsigned(i)])
-            {
-              trackAssignment[asUnsigned(p)] = t.trackId;
-              sinePeaks[asUnsigned(p)].assigned = true;
-              t.assigned = true;
-              t.peaks.push_back(sinePeaks[asUnsigned(p)]);
-            }
+            mTrackAssignment[asUnsigned(p)] = t->trackId;
+            mPeaks[asUnsigned(p)].assigned = true;
+            t->assigned = true;
+            t->peaks.push_back(mPeaks[asUnsigned(p)]);
           }
         }
-        else if (aboveBirthThreshold && useful(i, assignment(i)) &&
-                 !mPrevPeaks[asUnsigned(i)].assigned)
+        else if (aboveBirthThreshold && !prev.assigned)
         {
           mLastTrackId = mLastTrackId + 1;
-          auto newTrack = SineTrack{vector<SinePeak>{mPrevPeaks[asUnsigned(i)],
-                                                     sinePeaks[asUnsigned(p)]},
-                                    mCurrentFrame - 1,
-                                    -1,
-                                    true,
-                                    true,
-                                    mLastTrackId};
-          mTracks.push_back(newTrack);
-          sinePeaks[asUnsigned(p)].assigned = true;
-          trackAssignment[asUnsigned(p)] = newTrack.trackId;
+          mTracks.push_back(SineTrack{
+              vector<SinePeak>{prev, mPeaks[asUnsigned(p)]},
+              mCurrentFrame - 1, -1, true, true, mLastTrackId});
+          mPeaks[asUnsigned(p)].assigned = true;
+          mTrackAssignment[asUnsigned(p)] = mLastTrackId;
         }
       }
     }
@@ -239,8 +356,8 @@ private:
         track.endFrame = mCurrentFrame;
       }
     }
-    mPrevTracks = trackAssignment;
-    mPrevPeaks = sinePeaks;
+    swap(mPrevTracks, mTrackAssignment);
+    swap(mPrevPeaks, mPeaks);
     mPrevMaxAmp = maxAmp;
   }
 
@@ -250,36 +367,45 @@ private:
            mBirthRange * std::pow(0.0075, peak.freq / 20000.0);
   }
 
-  void assignGreedy(vector<SinePeak> sinePeaks, double maxAmp)
+  void assignGreedy(double maxAmp)
   {
     using namespace std;
-    vector<tuple<double, SineTrack*, SinePeak*>> distances;
+    mDistances.clear();
     for (auto&& track : mTracks) { track.assigned = false; }
+    sortByFreq(mPeaks, mPeakOrder);
     for (auto& track : mTracks)
     {
       if (track.active)
       {
-        for (auto&& peak : sinePeaks)
+        const SinePeak& last = track.peaks.back();
+        // only pairings inside the frequency gate can ever be useful
+        auto first = std::lower_bound(
+            mPeakOrder.begin(), mPeakOrder.end(), last.freq,
+            [this, &last](index p, double freq) {
+              return mPeaks[asUnsigned(p)].freq < freq &&
+                     outsideGate(mPeaks[asUnsigned(p)].freq, last.freq);
+            });
+        for (auto it = first; it != mPeakOrder.end(); ++it)
         {
-          double dist =
-              1 - exp(-pow(track.peaks.back().freq - peak.freq, 2) / mVarF -
-                      pow(track.peaks.back().logMag - peak.logMag, 2) / mVarA);
-          distances.push_back(std::make_tuple(dist, &track, &peak));
+          SinePeak& peak = mPeaks[asUnsigned(*it)];
+          if (peak.freq > last.freq && outsideGate(peak.freq, last.freq))
+            break;
+          double dist = usefulCost(last, peak);
+          if (isUseful(dist))
+            mDistances.push_back(std::make_tuple(dist, &track, &peak));
         }
       }
     }
 
-    sort(distances.begin(), distances.end(),
+    sort(mDistances.begin(), mDistances.end(),
          [](tuple<double, SineTrack*, SinePeak*> const& t1,
             tuple<double, SineTrack*, SinePeak*> const& t2) {
            return get<0>(t1) < get<0>(t2);
          });
 
-    for (auto&& pairing : distances)
+    for (auto&& pairing : mDistances)
     {
-      if (!get<1>(pairing)->assigned && !get<2>(pairing)->assigned &&
-          get<0>(pairing) <
-              (1 - (1 - mDelta) * get<0>(pairing))) // useful vs spurious
+      if (!get<1>(pairing)->assigned && !get<2>(pairing)->assigned)
       {
         get<1>(pairing)->peaks.push_back(*get<2>(pairing));
         get<1>(pairing)->assigned = true;
@@ -287,12 +413,10 @@ private:
       }
     }
     // new tracks
-    index nBorn = 0, nDead = 0;
-    for (auto&& peak : sinePeaks)
+    for (auto&& peak : mPeaks)
     {
       if (!peak.assigned && peak.logMag > birthThreshold(peak, maxAmp))
       {
-        nBorn++;
         mTracks.push_back(SineTrack{vector<SinePeak>{peak},
                                     static_cast<int>(mCurrentFrame), -1, true,
                                     true, mLastTrackId++});
@@ -303,7 +427,6 @@ private:
     {
       if (track.active && !track.assigned)
       {
-        nDead++;
         track.active = false;
         track.endFrame = mCurrentFrame;
       }
@@ -314,6 +437,7 @@ private:
   index             mCurrentFrame{0};
   vector<SineTrack> mTracks;
   bool              mInitialized{false};
+  vector<SinePeak>  mPeaks;
   vector<SinePeak>  mPrevPeaks;
   vector<index>     mPrevTracks;
   Munkres           mMunkres;
@@ -322,11 +446,25 @@ private:
   double            mZetaF{0};
   double            mVarF{0};
   double            mDelta{0};
+  double            mGateF{infinity};
   double            mPrevMaxAmp{0};
   index             mLastTrackId{1};
   double            mBirthLowThreshold{-24.};
   double            mBirthHighThreshold{-60.};
   double            mBirthRange{36.};
+
+  // assignment workspace, reused across frames
+  vector<std::tuple<double, SineTrack*, SinePeak*>> mDistances;
+  vector<index>                                     mTrackAssignment;
+  vector<index>                                     mRowAssignment;
+  vector<index>                                     mPrevOrder;
+  vector<index>                                     mPeakOrder;
+  vector<index>                                     mParent;
+  vector<index>                                     mRoots;
+  vector<index>                                     mComponentSize;
+  vector<index>                                     mNodes;
+  ArrayXXd                                          mCost;
+  ArrayXi                                           mAssignment;
 };
 } // namespace algorithm
 } // namespace fluid
@@ -10,6 +10,7 @@ under the European Union’s Horizon 2020 research and innovation programme
 
 #pragma once
 
+#include "OrderStatistics.hpp"
 #include "../../data/FluidIndex.hpp"
 #include <Eigen/Core>
 #include <cmath>
@@ -25,20 +26,20 @@ public:
                   double high)
   {
     using namespace std;
-    index   length = input.size();
     ArrayXd out = ArrayXd::Zero(7);
     double  mean = input.mean();
     double  stdev = sqrt((input - mean).square().mean());
     double skewness = ((input - mean) / (stdev == 0 ? 1 : stdev)).cube().mean();
     double kurtosis = ((input - mean) / (stdev == 0 ? 1 : stdev)).pow(4).mean();
-    ArrayXd sorted = input;
-    sort(sorted.data(), sorted.data() + length);
-    double lowVal = sorted(lrint(low * (length - 1)));
-    double midVal = sorted(lrint(mid * (length - 1)));
-    double highVal = sorted(lrint(high * (length - 1)));
-    out << mean, stdev, skewness, kurtosis, lowVal, midVal, highVal;
+    double  fractions[] = {low, mid, high};
+    out << mean, stdev, skewness, kurtosis, 0, 0, 0;
+    mScratch = input;
+    OrderStatistics::quantiles(mScratch, fractions, out.data() + 4, 3);
     return out;
   }
+
+private:
+  ArrayXd mScratch;
 };
 } // namespace algorithm
 } // namespace fluid
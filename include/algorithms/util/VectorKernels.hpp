@@ -0,0 +1,406 @@
+/*
+Part of the Fluid Corpus Manipulation Project (http://www.flucoma.org/)
+Copyright 2017-2019 University of Huddersfield.
+Licensed under the BSD-3 License.
+See license.md file in the project root for full license information.
+This project has received funding from the European Research Council (ERC)
+under the European Union’s Horizon 2020 research and innovation programme
+(grant agreement No 725899).
+*/
+
+/// Hot inner loops over contiguous doubles, each compiled as scalar, AVX2+FMA
+/// and AVX-512 code and dispatched on the CPU found at run time, so a build
+/// for a baseline x86 still gets wide vectors where they exist. Eigen picks
+/// its vector code at compile time, hence the hand written intrinsics. Other
+/// architectures get the scalar versions.
+
+#pragma once
+
+#include "CPUFeatures.hpp"
+#include "../../data/FluidIndex.hpp"
+#include <algorithm>
+#include <complex>
+
+namespace fluid {
+namespace algorithm {
+namespace kernels {
+namespace impl {
+
+inline double squaredDistanceScalar(const double* a, const double* b, index n)
+{
+  double result = 0;
+  for (index i = 0; i < n; i++)
+  {
+    double d = a[i] - b[i];
+    result += d * d;
+  }
+  return result;
+}
+
+inline double dotScalar(const double* a, const double* b, index n)
+{
+  double result = 0;
+  for (index i = 0; i < n; i++) result += a[i] * b[i];
+  return result;
+}
+
+inline void interleaveScalar(const double* re, const double* im, double scale,
+                             double* out, index n)
+{
+  for (index i = 0; i < n; i++)
+  {
+    out[2 * i] = scale * re[i];
+    out[2 * i + 1] = scale * im[i];
+  }
+}
+
+inline void deinterleaveScalar(const double* in, double* re, double* im,
+                               index n)
+{
+  for (index i = 0; i < n; i++)
+  {
+    re[i] = in[2 * i];
+    im[i] = in[2 * i + 1];
+  }
+}
+
+inline void divideClampedScalar(const double* num, const double* den,
+                                double floor, double* out, index n)
+{
+  for (index i = 0; i < n; i++) out[i] = num[i] / std::max(den[i], floor);
+}
+
+inline void multiplyDivideClampedScalar(double* x, const double* num,
+                                        const double* den, double floor,
+                                        index n)
+{
+  for (index i = 0; i < n; i++)
+    x[i] = x[i] * num[i] / std::max(den[i], floor);
+}
+
+#ifdef FLUID_X86
+
+FLUID_TARGET("avx2,fma")
+inline double horizontalSum(__m256d v)
+{
+  __m128d s =
+      _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+  return _mm_cvtsd_f64(_mm_add_sd(s, _mm_unpackhi_pd(s, s)));
+}
+
+FLUID_TARGET("avx2,fma")
+inline double squaredDistanceAVX2(const double* a, const double* b, index n)
+{
+  __m256d acc0 = _mm256_setzero_pd();
+  __m256d acc1 = _mm256_setzero_pd();
+  index   i = 0;
+  for (; i + 8 <= n; i += 8)
+  {
+    __m256d d0 = _mm256_sub_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i));
+    __m256d d1 =
+        _mm256_sub_pd(_mm256_loadu_pd(a + i + 4), _mm256_loadu_pd(b + i + 4));
+    acc0 = _mm256_fmadd_pd(d0, d0, acc0);
+    acc1 = _mm256_fmadd_pd(d1, d1, acc1);
+  }
+  for (; i + 4 <= n; i += 4)
+  {
+    __m256d d = _mm256_sub_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i));
+    acc0 = _mm256_fmadd_pd(d, d, acc0);
+  }
+  return horizontalSum(_mm256_add_pd(acc0, acc1)) +
+         squaredDistanceScalar(a + i, b + i, n - i);
+}
+
+FLUID_TARGET("avx2,fma")
+inline double dotAVX2(const double* a, const double* b, index n)
+{
+  __m256d acc0 = _mm256_setzero_pd();
+  __m256d acc1 = _mm256_setzero_pd();
+  index   i = 0;
+  for (; i + 8 <= n; i += 8)
+  {
+    acc0 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i),
+                           acc0);
+    acc1 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i + 4),
+                           _mm256_loadu_pd(b + i + 4), acc1);
+  }
+  for (; i + 4 <= n; i += 4)
+    acc0 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i),
+                           acc0);
+  return horizontalSum(_mm256_add_pd(acc0, acc1)) +
+         dotScalar(a + i, b + i, n - i);
+}
+
+FLUID_TARGET("avx2,fma")
+inline void interleaveAVX2(const double* re, const double* im, double scale,
+                           double* out, index n)
+{
+  __m256d s = _mm256_set1_pd(scale);
+  index   i = 0;
+  for (; i + 4 <= n; i += 4)
+  {
+    __m256d r = _mm256_mul_pd(s, _mm256_loadu_pd(re + i));
+    __m256d m = _mm256_mul_pd(s, _mm256_loadu_pd(im + i));
+    __m256d lo = _mm256_unpacklo_pd(r, m); // r0 i0 r2 i2
+    __m256d hi = _mm256_unpackhi_pd(r, m); // r1 i1 r3 i3
+    _mm256_storeu_pd(out + 2 * i, _mm256_permute2f128_pd(lo, hi, 0x20));
+    _mm256_storeu_pd(out + 2 * i + 4, _mm256_permute2f128_pd(lo, hi, 0x31));
+  }
+  interleaveScalar(re + i, im + i, scale, out + 2 * i, n - i);
+}
+
+FLUID_TARGET("avx2,fma")
+inline void deinterleaveAVX2(const double* in, double* re, double* im,
+                             index n)
+{
+  index i = 0;
+  for (; i + 4 <= n; i += 4)
+  {
+    __m256d c0 = _mm256_loadu_pd(in + 2 * i);
+    __m256d c1 = _mm256_loadu_pd(in + 2 * i + 4);
+    __m256d lo = _mm256_permute2f128_pd(c0, c1, 0x20); // r0 i0 r2 i2
+    __m256d hi = _mm256_permute2f128_pd(c0, c1, 0x31); // r1 i1 r3 i3
+    _mm256_storeu_pd(re + i, _mm256_unpacklo_pd(lo, hi));
+    _mm256_storeu_pd(im + i, _mm256_unpackhi_pd(lo, hi));
+  }
+  deinterleaveScalar(in + 2 * i, re + i, im + i, n - i);
+}
+
+FLUID_TARGET("avx2,fma")
+inline void divideClampedAVX2(const double* num, const double* den,
+                              double floor, double* out, index n)
+{
+  __m256d f = _mm256_set1_pd(floor);
+  index   i = 0;
+  for (; i + 4 <= n; i += 4)
+    _mm256_storeu_pd(out + i,
+                     _mm256_div_pd(_mm256_loadu_pd(num + i),
+                                   _mm256_max_pd(_mm256_loadu_pd(den + i), f)));
+  divideClampedScalar(num + i, den + i, floor, out + i, n - i);
+}
+
+FLUID_TARGET("avx2,fma")
+inline void multiplyDivideClampedAVX2(double* x, const double* num,
+                                      const double* den, double floor, index n)
+{
+  __m256d f = _mm256_set1_pd(floor);
+  index   i = 0;
+  for (; i + 4 <= n; i += 4)
+  {
+    __m256d prod =
+        _mm256_mul_pd(_mm256_loadu_pd(x + i), _mm256_loadu_pd(num + i));
+    _mm256_storeu_pd(
+        x + i, _mm256_div_pd(prod, _mm256_max_pd(_mm256_loadu_pd(den + i), f)));
+  }
+  multiplyDivideClampedScalar(x + i, num + i, den + i, floor, n - i);
+}
+
+// AVX-512 versions handle their tails with masked loads where that is simple
+inline __mmask8 tailMask(index remaining)
+{
+  return static_cast<__mmask8>((1u << remaining) - 1);
+}
+
+// GCC 12 warns that the undefined vector many unmasked AVX-512 intrinsics
+// pass through (_mm512_reduce_add_pd, _mm512_extractf64x4_pd, _mm512_max_pd)
+// is used uninitialized, so these kernels use masked forms with a defined
+// source instead
+FLUID_TARGET("avx512f")
+inline double horizontalSum(__m512d v)
+{
+  __m256d h = _mm256_add_pd(_mm512_maskz_extractf64x4_pd(0xf, v, 0),
+                            _mm512_maskz_extractf64x4_pd(0xf, v, 1));
+  __m128d s =
+      _mm_add_pd(_mm256_castpd256_pd128(h), _mm256_extractf128_pd(h, 1));
+  return _mm_cvtsd_f64(_mm_add_sd(s, _mm_unpackhi_pd(s, s)));
+}
+
+FLUID_TARGET("avx512f")
+inline double squaredDistanceAVX512(const double* a, const double* b, index n)
+{
+  __m512d acc0 = _mm512_setzero_pd();
+  __m512d acc1 = _mm512_setzero_pd();
+  index   i = 0;
+  for (; i + 16 <= n; i += 16)
+  {
+    __m512d d0 = _mm512_sub_pd(_mm512_loadu_pd(a + i), _mm512_loadu_pd(b + i));
+    __m512d d1 =
+        _mm512_sub_pd(_mm512_loadu_pd(a + i + 8), _mm512_loadu_pd(b + i + 8));
+    acc0 = _mm512_fmadd_pd(d0, d0, acc0);
+    acc1 = _mm512_fmadd_pd(d1, d1, acc1);
+  }
+  for (; i < n; i += 8)
+  {
+    __mmask8 m = n - i >= 8 ? __mmask8(0xff) : tailMask(n - i);
+    __m512d  d = _mm512_sub_pd(_mm512_maskz_loadu_pd(m, a + i),
+                              _mm512_maskz_loadu_pd(m, b + i));
+    acc0 = _mm512_fmadd_pd(d, d, acc0);
+  }
+  return horizontalSum(_mm512_add_pd(acc0, acc1));
+}
+
+FLUID_TARGET("avx512f")
+inline double dotAVX512(const double* a, const double* b, index n)
+{
+  __m512d acc0 = _mm512_setzero_pd();
+  __m512d acc1 = _mm512_setzero_pd();
+  index   i = 0;
+  for (; i + 16 <= n; i += 16)
+  {
+    acc0 = _mm512_fmadd_pd(_mm512_loadu_pd(a + i), _mm512_loadu_pd(b + i),
+                           acc0);
+    acc1 = _mm512_fmadd_pd(_mm512_loadu_pd(a + i + 8),
+                           _mm512_loadu_pd(b + i + 8), acc1);
+  }
+  for (; i < n; i += 8)
+  {
+    __mmask8 m = n - i >= 8 ? __mmask8(0xff) : tailMask(n - i);
+    acc0 = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(m, a + i),
+                           _mm512_maskz_loadu_pd(m, b + i), acc0);
+  }
+  return horizontalSum(_mm512_add_pd(acc0, acc1));
+}
+
+FLUID_TARGET("avx512f")
+inline void interleaveAVX512(const double* re, const double* im, double scale,
+                             double* out, index n)
+{
+  const __m512i first = _mm512_set_epi64(11, 3, 10, 2, 9, 1, 8, 0);
+  const __m512i second = _mm512_set_epi64(15, 7, 14, 6, 13, 5, 12, 4);
+  __m512d       s = _mm512_set1_pd(scale);
+  index         i = 0;
+  for (; i + 8 <= n; i += 8)
+  {
+    __m512d r = _mm512_mul_pd(s, _mm512_loadu_pd(re + i));
+    __m512d m = _mm512_mul_pd(s, _mm512_loadu_pd(im + i));
+    _mm512_storeu_pd(out + 2 * i, _mm512_permutex2var_pd(r, first, m));
+    _mm512_storeu_pd(out + 2 * i + 8, _mm512_permutex2var_pd(r, second, m));
+  }
+  interleaveScalar(re + i, im + i, scale, out + 2 * i, n - i);
+}
+
+FLUID_TARGET("avx512f")
+inline void deinterleaveAVX512(const double* in, double* re, double* im,
+                               index n)
+{
+  const __m512i even = _mm512_set_epi64(14, 12, 10, 8, 6, 4, 2, 0);
+  const __m512i odd = _mm512_set_epi64(15, 13, 11, 9, 7, 5, 3, 1);
+  index         i = 0;
+  for (; i + 8 <= n; i += 8)
+  {
+    __m512d c0 = _mm512_loadu_pd(in + 2 * i);
+    __m512d c1 = _mm512_loadu_pd(in + 2 * i + 8);
+    _mm512_storeu_pd(re + i, _mm512_permutex2var_pd(c0, even, c1));
+    _mm512_storeu_pd(im + i, _mm512_permutex2var_pd(c0, odd, c1));
+  }
+  deinterleaveScalar(in + 2 * i, re + i, im + i, n - i);
+}
+
+FLUID_TARGET("avx512f")
+inline void divideClampedAVX512(const double* num, const double* den,
+                                double floor, double* out, index n)
+{
+  __m512d f = _mm512_set1_pd(floor);
+  for (index i = 0; i < n; i += 8)
+  {
+    __mmask8 m = n - i >= 8 ? __mmask8(0xff) : tailMask(n - i);
+    // masked-off lanes divide 0 by floor, which is harmless
+    __m512d d = _mm512_mask_max_pd(f, m, _mm512_maskz_loadu_pd(m, den + i), f);
+    _mm512_mask_storeu_pd(out + i, m,
+                          _mm512_div_pd(_mm512_maskz_loadu_pd(m, num + i), d));
+  }
+}
+
+FLUID_TARGET("avx512f")
+inline void multiplyDivideClampedAVX512(double* x, const double* num,
+                                        const double* den, double floor,
+                                        index n)
+{
+  __m512d f = _mm512_set1_pd(floor);
+  for (index i = 0; i < n; i += 8)
+  {
+    __mmask8 m = n - i >= 8 ? __mmask8(0xff) : tailMask(n - i);
+    __m512d  prod = _mm512_mul_pd(_mm512_maskz_loadu_pd(m, x + i),
+                                 _mm512_maskz_loadu_pd(m, num + i));
+    __m512d  d =
+        _mm512_mask_max_pd(f, m, _mm512_maskz_loadu_pd(m, den + i), f);
+    _mm512_mask_storeu_pd(x + i, m, _mm512_div_pd(prod, d));
+  }
+}
+
+template <typename Fn>
+Fn selectKernel(Fn scalar, Fn avx2, Fn avx512)
+{
+  switch (simdLevel())
+  {
+  case SIMDLevel::kAVX512: return avx512;
+  case SIMDLevel::kAVX2: return avx2;
+  default: return scalar;
+  }
+}
+
+#define FLUID_SELECT_KERNEL(name)                                              \
+  impl::selectKernel(impl::name##Scalar, impl::name##AVX2, impl::name##AVX512)
+#else
+#define FLUID_SELECT_KERNEL(name) impl::name##Scalar
+#endif
+
+// below this many elements a call through the dispatch pointer isn't worth it
+constexpr index kMinDispatchSize = 8;
+
+} // namespace impl
+
+/// sum((a - b)^2)
+inline double squaredDistance(const double* a, const double* b, index n)
+{
+  if (n < impl::kMinDispatchSize)
+    return impl::squaredDistanceScalar(a, b, n);
+  static const auto kernel = FLUID_SELECT_KERNEL(squaredDistance);
+  return kernel(a, b, n);
+}
+
+inline double dot(const double* a, const double* b, index n)
+{
+  if (n < impl::kMinDispatchSize) return impl::dotScalar(a, b, n);
+  static const auto kernel = FLUID_SELECT_KERNEL(dot);
+  return kernel(a, b, n);
+}
+
+/// out[i] = scale * (re[i], im[i])
+inline void interleave(const double* re, const double* im, double scale,
+                       std::complex<double>* out, index n)
+{
+  static const auto kernel = FLUID_SELECT_KERNEL(interleave);
+  kernel(re, im, scale, reinterpret_cast<double*>(out), n);
+}
+
+/// re[i] = in[i].real(), im[i] = in[i].imag()
+inline void deinterleave(const std::complex<double>* in, double* re,
+                         double* im, index n)
+{
+  static const auto kernel = FLUID_SELECT_KERNEL(deinterleave);
+  kernel(reinterpret_cast<const double*>(in), re, im, n);
+}
+
+/// out[i] = num[i] / max(den[i], floor); out may alias num or den
+inline void divideClamped(const double* num, const double* den, double floor,
+                          double* out, index n)
+{
+  static const auto kernel = FLUID_SELECT_KERNEL(divideClamped);
+  kernel(num, den, floor, out, n);
+}
+
+/// x[i] = x[i] * num[i] / max(den[i], floor), the multiplicative update of
+/// NMF and friends
+inline void multiplyDivideClamped(double* x, const double* num,
+                                  const double* den, double floor, index n)
+{
+  static const auto kernel = FLUID_SELECT_KERNEL(multiplyDivideClamped);
+  kernel(x, num, den, floor, n);
+}
+
+#undef FLUID_SELECT_KERNEL
+
+} // namespace kernels
+} // namespace algorithm
+} // namespace fluid
@@ -11,6 +11,7 @@ under the European Union’s Horizon 2020 research and innovation programme
 #pragma once
 
 #include "FluidEigenMappings.hpp"
+#include "OrderStatistics.hpp"
 #include "../../data/FluidIndex.hpp"
 #include "../../data/TensorTypes.hpp"
 #include <Eigen/Core>
@@ -37,41 +38,20 @@ public:
         (weights * ((input - mean) / (stdev == 0 ? 1 : stdev)).cube()).sum();
     double kurtosis =
         (weights * ((input - mean) / (stdev == 0 ? 1 : stdev)).pow(4)).sum();
-    ArrayXd sorted = input;
-    ArrayXi perm = ArrayXi::LinSpaced(length, 0, length - 1);
-    std::sort(perm.data(), perm.data() + length,
-              [&](size_t i, size_t j) { return input(i) < input(j); });
-    index  level = 0;
-    double lowVal{input(perm(0))};
-    double midVal{input(perm(lrint(length - 1) / 2))};
-    double hiVal{input(perm(lrint(length - 1)))};
-    double acc = weights(perm(0)), prevAcc = 0;
-    for (index i = 1; i < length; i++)
-    {
-      acc += weights(perm(i));
-      if (level == 0 && acc >= low)
-      {
-        lowVal = abs(prevAcc - low) <= abs(acc - low) ? input(perm(i - 1))
-                                                      : input(perm(i));
-        level = 1;
-      }
-      if (level == 1 && acc >= mid)
-      {
-        midVal = abs(prevAcc - mid) < abs(acc - mid) ? input(perm(i - 1))
-                                                     : input(perm(i));
-        level = 2;
-      }
-      if (level == 2 && acc >= high)
-      {
-        hiVal = abs(prevAcc - high) < abs(acc - high) ? input(perm(i - 1))
-                                                      : input(perm(i));
-        break;
-      }
-      prevAcc = acc;
-    }
-    out << mean, stdev, skewness, kurtosis, lowVal, midVal, hiVal;
+    double fractions[] = {low, mid, high};
+    bool   inclusive[] = {true, false, false};
+    index  fallbackRanks[] = {0, (length - 1) / 2, length - 1};
+    double quantiles[3];
+    mPerm.resize(length);
+    OrderStatistics::weightedQuantiles(input, weights, mPerm, fractions,
+                                       inclusive, fallbackRanks, quantiles, 3);
+    out << mean, stdev, skewness, kurtosis, quantiles[0], quantiles[1],
+        quantiles[2];
     return out;
   }
+
+private:
+  Eigen::ArrayXi mPerm;
 };
 } // namespace algorithm
 } // namespace fluid
@@ -20,6 +20,9 @@ under the European Union’s Horizon 2020 research and innovation programme
 #include "../../data/FluidTensor.hpp"
 #include "../../data/TensorTypes.hpp"
 #include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
 
 namespace fluid {
 namespace client {
@@ -42,6 +45,7 @@ public:
            "Window in bigger than maximum");
     assert(windowSizeOut <= maxWindowSizeOut() &&
            "Window out bigger than maximum");
+    FluidTask* task = c.task();
     for (; mFrameTime < mHostSize; mFrameTime += hopSize)
     {
       RealMatrixView windowIn = mFrameIn(Slice(0), Slice(0, windowSizeIn));
@@ -50,11 +54,11 @@ public:
       processFunc(windowIn, windowOut);
       mSink.push(windowOut, mFrameTime);
 
-      if (FluidTask* t = c.task())
-        if (!t->processUpdate(
-                static_cast<double>(std::min(mFrameTime + hopSize, mHostSize)),
-                static_cast<double>(mHostSize)))
-          break;
+      if (task &&
+          !task->processUpdate(
+              static_cast<double>(std::min(mFrameTime + hopSize, mHostSize)),
+              static_cast<double>(mHostSize)))
+        break;
     }
     mFrameTime = mFrameTime < mHostSize ? mFrameTime : mFrameTime - mHostSize;
   }
@@ -64,17 +68,18 @@ public:
                     F processFunc)
   {
     assert(windowSize <= maxWindowSizeIn() && "Window bigger than maximum");
+    FluidTask* task = c.task();
     for (; mFrameTime < mHostSize; mFrameTime += hopSize)
     {
       RealMatrixView windowIn = mFrameIn(Slice(0), Slice(0, windowSize));
       mSource.pull(windowIn, mFrameTime);
       processFunc(windowIn);
 
-      if (FluidTask* t = c.task())
-        if (!t->processUpdate(
-                static_cast<double>(std::min(mFrameTime + hopSize, mHostSize)),
-                static_cast<double>(mHostSize)))
-          break;
+      if (task &&
+          !task->processUpdate(
+              static_cast<double>(std::min(mFrameTime + hopSize, mHostSize)),
+              static_cast<double>(mHostSize)))
+        break;
     }
     mFrameTime = mFrameTime < mHostSize ? mFrameTime : mFrameTime - mHostSize;
   }
@@ -85,17 +90,18 @@ public:
   {
     assert(windowSizeOut <= maxWindowSizeOut() &&
            "Window out bigger than maximum");
+    FluidTask* task = c.task();
     for (; mFrameTime < mHostSize; mFrameTime += hopSize)
     {
       RealMatrixView windowOut = mFrameOut(Slice(0), Slice(0, windowSizeOut));
       processFunc(windowOut);
       mSink.push(windowOut, mFrameTime);
 
-      if (FluidTask* t = c.task())
-        if (!t->processUpdate(
-                static_cast<double>(std::min(mFrameTime + hopSize, mHostSize)),
-                static_cast<double>(mHostSize)))
-          break;
+      if (task &&
+          !task->processUpdate(
+              static_cast<double>(std::min(mFrameTime + hopSize, mHostSize)),
+              static_cast<double>(mHostSize)))
+        break;
     }
     mFrameTime = mFrameTime < mHostSize ? mFrameTime : mFrameTime - mHostSize;
   }
@@ -166,6 +172,167 @@ private:
   FluidSink<double>   mSink;
 };
 
+/// A magnitude analysis of one signal shared by several clients, so that a
+/// rack of descriptors on the same input runs one window and FFT per frame
+/// instead of one each. Clients subscribe by a name for the signal when they
+/// are reset (see STFTBufferedProcess::reset), never while processing.
+///
+/// Sharing is keyed on the host's cycle count (FluidContext::hostCycle). The
+/// first subscriber processed in a cycle pushes its block and runs the
+/// analysis; later ones in the same cycle with the same FFT settings are
+/// handed the stored frames. Without a count, as offline, a subscriber always
+/// analyses its own input, and so it does for blocks too long to store every
+/// frame of. A reset() of a subscriber restarts the analysis for all of them
+/// if it comes before the analysis has run in a cycle, at most once per cycle;
+/// one that resets later in the cycle joins the analysis as it stands
+class SharedSTFTAnalysis
+{
+public:
+  // Blocks with more frames than this only come from offline-sized host
+  // buffers, where storing them all for other subscribers costs more than
+  // it saves
+  static constexpr index kMaxFrames = 256;
+
+  explicit SharedSTFTAnalysis(index channels) : mChannels(channels) {}
+
+  static std::shared_ptr<SharedSTFTAnalysis> subscribe(const std::string& name,
+                                                       index channels)
+  {
+    using LookupTable =
+        std::unordered_map<std::string, std::weak_ptr<SharedSTFTAnalysis>>;
+    static LookupTable table;
+    static std::mutex  tableMutex;
+
+    std::lock_guard<std::mutex> lock(tableMutex);
+    for (auto it = table.begin(); it != table.end();)
+      it = it->second.expired() ? table.erase(it) : std::next(it);
+
+    auto& entry = table[name + '/' + std::to_string(channels)];
+    auto  analysis = entry.lock();
+    if (!analysis)
+    {
+      analysis = std::make_shared<SharedSTFTAnalysis>(channels);
+      entry = analysis;
+    }
+    return analysis;
+  }
+
+  /// Passes processFunc the magnitudes (channels x bins) of each frame
+  /// ending in this block of input. Returns false, having analysed nothing, if
+  /// the caller should analyse the block itself. restart is the caller's
+  /// pending reset, cleared once applied
+  template <typename T, typename F>
+  bool process(const FFTParams& fftParams,
+               const std::vector<HostVector<T>>& input, bool& restart,
+               FluidContext& c, F&& processFunc)
+  {
+    index cycle = c.hostCycle();
+    index hostSize = input[0].size();
+    if (cycle <= 0 || asSigned(input.size()) != mChannels ||
+        hostSize / fftParams.hopSize() + 1 > kMaxFrames)
+      return false;
+
+    // A reset restarts the analysis at most once a cycle, and only before it
+    // has run: a subscriber that resets after that joins it as it stands
+    if (restart)
+    {
+      if (mRestartCycle != cycle && mCycle != cycle)
+      {
+        if (mWindowSize > 0)
+        {
+          mBufferedProcess.reset();
+          mCycle = -1;
+        }
+        mRestartCycle = cycle;
+      }
+      restart = false;
+    }
+
+    bool sameSettings = fftParams.winSize() == mWindowSize &&
+                        fftParams.fftSize() == mFFTSize &&
+                        fftParams.hopSize() == mHopSize;
+
+    if (cycle == mCycle)
+    {
+      if (!sameSettings || hostSize != mHostSize) return false;
+      for (index i = 0; i < mNumFrames; ++i) processFunc(frame(i));
+      mUsedCycle = cycle;
+      return true;
+    }
+
+    if (!sameSettings)
+    {
+      // Only retune once nobody used the current settings in the last cycle,
+      // so that subscribers which disagree don't retune it every cycle
+      if (mUsedCycle >= cycle - 1) return false;
+      configure(fftParams);
+    }
+
+    analyse(input, c, processFunc);
+    mCycle = mUsedCycle = cycle;
+    return true;
+  }
+
+private:
+  void configure(const FFTParams& fftParams)
+  {
+    mWindowSize = fftParams.winSize();
+    mFFTSize = fftParams.fftSize();
+    mHopSize = fftParams.hopSize();
+    mFrameSize = fftParams.frameSize();
+    mSTFT.reset(new algorithm::STFT(mWindowSize, mFFTSize, mHopSize));
+    mBufferedProcess.maxSize(mWindowSize, mWindowSize, mChannels, 0);
+    mHostSize = -1;
+  }
+
+  template <typename T, typename F>
+  void analyse(const std::vector<HostVector<T>>& input, FluidContext& c,
+               F& processFunc)
+  {
+    index hostSize = input[0].size();
+    if (hostSize != mHostSize)
+    {
+      mBufferedProcess.hostSize(hostSize);
+      mHostSize = hostSize;
+    }
+    index maxFrames = hostSize / mHopSize + 1;
+    if (mFrames.rows() < mChannels * maxFrames || mFrames.cols() != mFrameSize)
+      mFrames.resize(mChannels * maxFrames, mFrameSize);
+
+    mBufferedProcess.push(input);
+    mNumFrames = 0;
+    mBufferedProcess.processInput(
+        mWindowSize, mHopSize, c, [&](RealMatrixView in) {
+          RealMatrixView magnitudes = frame(mNumFrames++);
+          {
+            auto timer = c.time("stft");
+            for (index i = 0; i < mChannels; ++i)
+              mSTFT->processFrameMagnitude(in.row(i), magnitudes.row(i));
+          }
+          processFunc(magnitudes);
+        });
+  }
+
+  RealMatrixView frame(index i)
+  {
+    return mFrames(Slice(i * mChannels, mChannels), Slice(0, mFrameSize));
+  }
+
+  index                            mChannels;
+  index                            mWindowSize{0};
+  index                            mFFTSize{0};
+  index                            mHopSize{0};
+  index                            mFrameSize{0};
+  index                            mHostSize{-1};
+  std::unique_ptr<algorithm::STFT> mSTFT;
+  BufferedProcess                  mBufferedProcess;
+  RealMatrix                       mFrames;
+  index                            mNumFrames{0};
+  index                            mCycle{-1};
+  index                            mUsedCycle{-1};
+  index                            mRestartCycle{-1};
+};
+
 template <typename Params, index FFTParamsIndex, bool Normalise = true>
 class STFTBufferedProcess
 {
@@ -197,13 +364,20 @@ public:
 
     mBufferedProcess.process(
         fftParams.winSize(), fftParams.winSize(), fftParams.hopSize(), c,
-        [this, &processFunc, chansIn, chansOut](RealMatrixView in,
-                                                RealMatrixView out) {
-          for (index i = 0; i < chansIn; ++i)
-            mSTFT->processFrame(in.row(i), mSpectrumIn.row(i));
+        [this, &processFunc, &c, chansIn, chansOut](RealMatrixView in,
+                                                    RealMatrixView out) {
+          {
+            auto timer = c.time("stft");
+            for (index i = 0; i < chansIn; ++i)
+              mSTFT->processFrame(in.row(i), mSpectrumIn.row(i));
+          }
           processFunc(mSpectrumIn, mSpectrumOut(Slice(0, chansOut), Slice(0)));
-          for (index i = 0; i < chansOut; ++i)
-            mISTFT->processFrame(mSpectrumOut.row(i), out.row(i));
+          {
+            auto timer = c.time("istft");
+            for (index i = 0; i < chansOut; ++i)
+              mISTFT->processFrame(mSpectrumOut.row(i), out.row(i));
+          }
+          c.count("frames");
           if (Normalise)
           {
             out.row(chansOut) = mSTFT->window();
@@ -241,13 +415,61 @@ public:
 
     mBufferedProcess.processInput(
         fftParams.winSize(), fftParams.hopSize(), c,
-        [this, &processFunc, chansIn](RealMatrixView in) {
-          for (index i = 0; i < chansIn; ++i)
-            mSTFT->processFrame(in.row(i), mSpectrumIn.row(i));
+        [this, &processFunc, &c, chansIn](RealMatrixView in) {
+          {
+            auto timer = c.time("stft");
+            for (index i = 0; i < chansIn; ++i)
+              mSTFT->processFrame(in.row(i), mSpectrumIn.row(i));
+          }
           processFunc(mSpectrumIn);
+          c.count("frames");
         });
   }
 
+  // As processInput, for clients that only want magnitudes: processFunc gets
+  // one magnitude spectrum per input channel, with no complex spectrum formed.
+  // After a reset with an analysis name, frames come from the shared analysis
+  // whenever it can provide them
+  template <typename T, typename F>
+  void processInputMagnitude(Params& p, const std::vector<HostVector<T>>& input,
+                             FluidContext& c, F&& processFunc)
+  {
+
+    if (!input[0].data()) return;
+    assert(mBufferedProcess.channelsIn() == asSigned(input.size()));
+
+    if (mShared &&
+        mShared->process(p.template get<FFTParamsIndex>(), input,
+                         mRestartShared, c,
+                         [&processFunc, &c](RealMatrixView magnitudes) {
+                           processFunc(magnitudes);
+                           c.count("frames");
+                         }))
+    {
+      mSharing = true;
+      return;
+    }
+    // our own buffer missed the blocks the shared analysis took
+    if (mSharing) mBufferedProcess.reset();
+    mSharing = false;
+
+    index     chansIn = mBufferedProcess.channelsIn();
+    FFTParams fftParams = setup(p, input[0].size());
+
+    mBufferedProcess.push(input);
+
+    mBufferedProcess.processInput(
+        fftParams.winSize(), fftParams.hopSize(), c,
+        [this, &processFunc, &c, chansIn](RealMatrixView in) {
+          {
+            auto timer = c.time("stft");
+            for (index i = 0; i < chansIn; ++i)
+              mSTFT->processFrameMagnitude(in.row(i), mMagnitudeIn.row(i));
+          }
+          processFunc(mMagnitudeIn);
+          c.count("frames");
+        });
+  }
 
   template <typename T, typename F>
   void processOutput(Params& p, std::vector<HostVector<T>>& output,
@@ -260,10 +482,14 @@ public:
 
     mBufferedProcess.processOutput(
         fftParams.winSize(), fftParams.hopSize(), c,
-        [this, &processFunc, chansOut](RealMatrixView out) {
+        [this, &processFunc, &c, chansOut](RealMatrixView out) {
           processFunc(mSpectrumOut(Slice(0, chansOut), Slice(0)));
-          for (index i = 0; i < chansOut; ++i)
-          { mISTFT->processFrame(mSpectrumOut.row(i), out.row(i)); }
+          {
+            auto timer = c.time("istft");
+            for (index i = 0; i < chansOut; ++i)
+              mISTFT->processFrame(mSpectrumOut.row(i), out.row(i));
+          }
+          c.count("frames");
 
           if (Normalise)
           {
@@ -290,6 +516,19 @@ public:
 
   void reset() { mBufferedProcess.reset(); }
 
+  // As reset(), also joining the shared analysis of that name (see
+  // SharedSTFTAnalysis), which restarts on the next cycle; an empty name
+  // keeps the analysis private. Not for the audio thread
+  void reset(const std::string& sharedName)
+  {
+    reset();
+    mShared = sharedName.empty() ? nullptr
+                                 : SharedSTFTAnalysis::subscribe(
+                                       sharedName, mBufferedProcess.channelsIn());
+    mRestartShared = true;
+    mSharing = false;
+  }
+
 private:
   FFTParams setup(Params& p, index hostBufferSize)
   {
@@ -312,6 +551,9 @@ private:
     if (fftParams.frameSize() != mSpectrumIn.cols())
       mSpectrumIn.resize(chansIn, fftParams.frameSize());
 
+    if (fftParams.frameSize() != mMagnitudeIn.cols())
+      mMagnitudeIn.resize(chansIn, fftParams.frameSize());
+
     if (fftParams.frameSize() != mSpectrumOut.cols())
       mSpectrumOut.resize(chansOut, fftParams.frameSize());
 
@@ -328,10 +570,14 @@ private:
   ParameterTrackChanges<index>               mTrackHostVS;
   RealMatrix                                 mFrameAndWindow;
   ComplexMatrix                              mSpectrumIn;
+  RealMatrix                                 mMagnitudeIn;
   ComplexMatrix                              mSpectrumOut;
   std::unique_ptr<algorithm::STFT>           mSTFT;
   std::unique_ptr<algorithm::ISTFT>          mISTFT;
   BufferedProcess                            mBufferedProcess;
+  std::shared_ptr<SharedSTFTAnalysis>        mShared;
+  bool                                       mRestartShared{false};
+  bool                                       mSharing{false};
 };
 
 } // namespace client
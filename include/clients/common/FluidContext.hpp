@@ -9,6 +9,7 @@ under the European Union’s Horizon 2020 research and innovation programme
 */
 #pragma once
 
+#include "../common/FluidProfiler.hpp"
 #include "../common/FluidTask.hpp"
 #include "../common/Result.hpp"
 
@@ -28,8 +29,28 @@ public:
   FluidTask* task() { return mTask; }
   void       task(FluidTask* t) { mTask = t; }
 
+  Profiler* profiler() { return mProfiler; }
+  void      profiler(Profiler* p) { mProfiler = p; }
+
+  // The host's count of DSP cycles, advanced once per cycle and the same for
+  // every client processed in it, so that clients can tell they are seeing
+  // the same block. Only hosts that process all clients on one thread should
+  // set it; 0, the default (and always offline), means no count
+  index hostCycle() const { return mHostCycle; }
+  void  hostCycle(index cycle) { mHostCycle = cycle; }
+
+  // Instrumentation, a no-op unless a profiler is attached:
+  // auto timer = c.time("stft"); times until the end of the scope
+  ScopedTimer time(const char* stage) { return {mProfiler, stage}; }
+  void        count(const char* stage, index n = 1)
+  {
+    if (mProfiler) mProfiler->addCount(stage, n);
+  }
+
 private:
   FluidTask*  mTask{nullptr};
+  Profiler*   mProfiler{nullptr};
+  index       mHostCycle{0};
   MessageList mMessages;
 };
 
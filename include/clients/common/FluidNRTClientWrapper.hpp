@@ -483,14 +483,18 @@ struct Streaming
     {
       std::vector<HostVectorView> inputs;
       inputs.reserve(inputBuffers.size());
-      for (index j = 0; j < asSigned(inputBuffers.size()); ++j)
       {
-        BufferAdaptor::ReadAccess thisInput(inputBuffers[asUnsigned(j)].buffer);
-        if (i == 0 && j == 0) sampleRate = thisInput.sampleRate();
-        inputData[asUnsigned(j)].row(i)(Slice(userPadding.first, nFrames)) =
-            thisInput.samps(inputBuffers[asUnsigned(j)].startFrame, nFrames,
-                            inputBuffers[asUnsigned(j)].startChan + i);
-        inputs.emplace_back(inputData[asUnsigned(j)].row(i));
+        auto timer = c.time("copyIn");
+        for (index j = 0; j < asSigned(inputBuffers.size()); ++j)
+        {
+          BufferAdaptor::ReadAccess thisInput(
+              inputBuffers[asUnsigned(j)].buffer);
+          if (i == 0 && j == 0) sampleRate = thisInput.sampleRate();
+          inputData[asUnsigned(j)].row(i)(Slice(userPadding.first, nFrames)) =
+              thisInput.samps(inputBuffers[asUnsigned(j)].startFrame, nFrames,
+                              inputBuffers[asUnsigned(j)].startChan + i);
+          inputs.emplace_back(inputData[asUnsigned(j)].row(i));
+        }
       }
 
       std::vector<HostVectorView> outputs;
@@ -506,6 +510,7 @@ struct Streaming
       client.process(inputs, outputs, c);
     }
 
+    auto timer = c.time("copyOut");
     for (index i = 0; i < asSigned(outputBuffers.size()); ++i)
     {
       if (!outputBuffers[asUnsigned(i)]) continue;
@@ -564,19 +569,26 @@ struct StreamingControl
     HostMatrix outputData(nChans * nFeatures, nHops);
     double     sampleRate{0};
     // Copy input data
-    for (index i = 0; i < nChans; ++i)
     {
-      for (index j = 0; j < asSigned(inputBuffers.size()); ++j)
+      auto timer = c.time("copyIn");
+      for (index i = 0; i < nChans; ++i)
       {
-        BufferAdaptor::ReadAccess thisInput(inputBuffers[asUnsigned(j)].buffer);
-        if (i == 0 && j == 0) sampleRate = thisInput.sampleRate();
-        inputData[asUnsigned(j)].row(i)(Slice(userPadding.first, nFrames)) =
-            thisInput.samps(inputBuffers[asUnsigned(j)].startFrame, nFrames,
-                            inputBuffers[asUnsigned(j)].startChan + i);
+        for (index j = 0; j < asSigned(inputBuffers.size()); ++j)
+        {
+          BufferAdaptor::ReadAccess thisInput(
+              inputBuffers[asUnsigned(j)].buffer);
+          if (i == 0 && j == 0) sampleRate = thisInput.sampleRate();
+          inputData[asUnsigned(j)].row(i)(Slice(userPadding.first, nFrames)) =
+              thisInput.samps(inputBuffers[asUnsigned(j)].startFrame, nFrames,
+                              inputBuffers[asUnsigned(j)].startChan + i);
+        }
       }
     }
     FluidTask*   task = c.task();
+    // no host cycle count, so a client's analysisName is inert offline: each
+    // job analyses its own input (see SharedSTFTAnalysis)
     FluidContext dummyContext;
+    dummyContext.profiler(c.profiler());
     for (index i = 0; i < nChans; ++i)
     {
       client.reset();
@@ -605,6 +617,7 @@ struct StreamingControl
       }
     }
 
+    auto                  timer = c.time("copyOut");
     BufferAdaptor::Access thisOutput(outputBuffers[0]);
 
     index latencyHops = client.latency() / client.controlRate();
@@ -647,12 +660,15 @@ struct Slicing
     HostMatrix monoSource(1, nFrames + totalPadding);
 
     BufferAdaptor::ReadAccess src(inputBuffers[0].buffer);
-    // Make a mono sum;
-    for (index i = inputBuffers[0].startChan;
-         i < nChans + inputBuffers[0].startChan; ++i)
-      monoSource.row(0)(Slice(0, nFrames))
-          .apply(src.samps(inputBuffers[0].startFrame, nFrames, i),
-                 [](float& x, float y) { x += y; });
+    {
+      auto timer = c.time("copyIn");
+      // Make a mono sum;
+      for (index i = inputBuffers[0].startChan;
+           i < nChans + inputBuffers[0].startChan; ++i)
+        monoSource.row(0)(Slice(0, nFrames))
+            .apply(src.samps(inputBuffers[0].startFrame, nFrames, i),
+                   [](float& x, float y) { x += y; });
+    }
 
     HostMatrix onsetPoints(1, nFrames + totalPadding);
 
@@ -672,6 +688,7 @@ struct Slicing
       if (numNegativeTimeOnsets > 0) onsetPoints(0, startPadding) = 1;
     }
 
+    auto timer = c.time("copyOut");
     return impl::spikesToTimes(onsetPoints(0, Slice(startPadding, nFrames)),
                                outputBuffers[0], 1, inputBuffers[0].startFrame,
                                nFrames, src.sampleRate());
@@ -834,7 +851,7 @@ public:
     if (mSynchronous) mSynchronousDone = false;
 
     mThreadedTask = std::unique_ptr<ThreadedTask>(
-        new ThreadedTask(mClient, mQueue.front(), mSynchronous));
+        new ThreadedTask(mClient, mQueue.front(), mSynchronous, mProfiler));
     mQueue.pop_front();
 
     if (mSynchronous)
@@ -874,7 +891,7 @@ public:
         if (!mQueue.empty())
         {
           mThreadedTask = std::unique_ptr<ThreadedTask>(
-              new ThreadedTask(mClient, mQueue.front(), false));
+              new ThreadedTask(mClient, mQueue.front(), false, mProfiler));
           mQueue.pop_front();
           state = kDoneStillProcessing;
           mThreadedTask->mState = kDoneStillProcessing;
@@ -924,6 +941,10 @@ public:
 
   void setCallback(std::function<void()> cb) { mCallback = cb; }
 
+  // Jobs started from now on report to profiler, which must outlive them and
+  // should only be read once they are done
+  void setProfiler(Profiler* profiler) { mProfiler = profiler; }
+
 private:
   void swap(NRTThreadingAdaptor&& x, bool includeParams)
   {
@@ -939,6 +960,7 @@ private:
     swap(mSynchronous, x.mSynchronous);
     swap(mQueueEnabled, x.mQueueEnabled);
     swap(mCallback, x.mCallback);
+    swap(mProfiler, x.mProfiler);
     mSynchronousDone = false;
     if (includeParams) mHostParams = std::move(x.mHostParams);
     mClient = std::move(x.mClient);
@@ -979,10 +1001,12 @@ private:
       void operator()(typename T::type& param) { param.reset(); }
     };
 
-    ThreadedTask(ClientPointer client, NRTJob& job, bool synchronous)
+    ThreadedTask(ClientPointer client, NRTJob& job, bool synchronous,
+                 Profiler* profiler)
         : mProcessParams(job.mParams), mState(kNoProcess),
           mClient(client), mContext{mTask}, mCallback{job.mCallback}
     {
+      mContext.profiler(profiler);
 
       assert(mClient.get() != nullptr); // right?
 
@@ -1081,6 +1105,7 @@ private:
   std::unique_ptr<ThreadedTask> mThreadedTask;
   ClientPointer                 mClient;
   std::function<void()>         mCallback;
+  Profiler*                     mProfiler{nullptr};
   std::atomic<bool>             mSynchronousDone{false};
 };
 
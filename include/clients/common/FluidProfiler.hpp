@@ -0,0 +1,104 @@
+/*
+Part of the Fluid Corpus Manipulation Project (http://www.flucoma.org/)
+Copyright 2017-2019 University of Huddersfield.
+Licensed under the BSD-3 License.
+See license.md file in the project root for full license information.
+This project has received funding from the European Research Council (ERC)
+under the European Union’s Horizon 2020 research and innovation programme
+(grant agreement No 725899).
+*/
+#pragma once
+
+#include "../../data/FluidIndex.hpp"
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace fluid {
+namespace client {
+
+/// Accumulates timings and counters by stage name ("stft", "solver",
+/// "copyIn"...). A host that wants them attaches one to a FluidContext;
+/// clients report through the context, which does nothing when no profiler is
+/// attached. Not thread safe: read the results once processing has finished
+class Profiler
+{
+public:
+  using Clock = std::chrono::steady_clock;
+
+  struct Stage
+  {
+    std::string name;
+    index       calls{0};   // number of timed scopes
+    double      seconds{0}; // total time spent in them
+    index       count{0};   // sum of counter increments
+  };
+
+  void addTime(const char* stage, Clock::duration elapsed)
+  {
+    Stage& s = find(stage);
+    s.calls++;
+    s.seconds += std::chrono::duration<double>(elapsed).count();
+  }
+
+  void addCount(const char* stage, index n) { find(stage).count += n; }
+
+  /// In order of first appearance
+  const std::vector<Stage>& stages() const { return mStages; }
+
+  const Stage* stage(const std::string& name) const
+  {
+    auto it = std::find_if(mStages.begin(), mStages.end(),
+                           [&name](const Stage& s) { return s.name == name; });
+    return it == mStages.end() ? nullptr : &*it;
+  }
+
+  void reset() { mStages.clear(); }
+
+private:
+  Stage& find(const char* stage)
+  {
+    for (auto& s : mStages)
+      if (s.name == stage) return s;
+    mStages.push_back({stage});
+    return mStages.back();
+  }
+
+  std::vector<Stage> mStages;
+};
+
+/// Times its own lifetime into a profiler's stage; inert given nullptr
+class ScopedTimer
+{
+public:
+  ScopedTimer(Profiler* profiler, const char* stage)
+      : mProfiler(profiler), mStage(stage)
+  {
+    if (mProfiler) mStart = Profiler::Clock::now();
+  }
+
+  ScopedTimer(ScopedTimer&& other) noexcept
+      : mProfiler(other.mProfiler), mStage(other.mStage), mStart(other.mStart)
+  {
+    other.mProfiler = nullptr;
+  }
+
+  ScopedTimer(const ScopedTimer&) = delete;
+  ScopedTimer& operator=(const ScopedTimer&) = delete;
+  ScopedTimer& operator=(ScopedTimer&&) = delete;
+
+  ~ScopedTimer()
+  {
+    if (mProfiler) mProfiler->addTime(mStage, Profiler::Clock::now() - mStart);
+  }
+
+private:
+  Profiler*                   mProfiler;
+  const char*                 mStage;
+  Profiler::Clock::time_point mStart{};
+};
+
+} // namespace client
+} // namespace fluid
@@ -10,42 +10,75 @@ under the European Union’s Horizon 2020 research and innovation programme
 
 #pragma once
 
+#include "../../data/FluidIndex.hpp"
+#include <algorithm>
 #include <atomic>
+#include <chrono>
 
 namespace fluid {
 
+// Progress and cancellation shared between a worker and the thread that
+// launched it. The worker may call processUpdate() in its tightest loop: the
+// cancel flag is a relaxed atomic read, and progress is only computed and
+// published every mStride calls, with mStride adapted so that publishing
+// happens about once per kPublishInterval
 class FluidTask
 {
+  using Clock = std::chrono::steady_clock;
+
 public:
   FluidTask() : mProgress(0.0), mCancel(false) {}
 
   bool processUpdate(double samplesDone, double taskLength)
   {
-    mProgress = (samplesDone / (taskLength * mTotalIterations)) +
-                (mIteration / mTotalIterations);
-    return !mCancel;
+    if (--mCountdown <= 0 || samplesDone >= taskLength)
+      publish(samplesDone, taskLength);
+    return !cancelled();
   }
 
   bool iterationUpdate(double iterationsDone, double totalIterations)
   {
     mIteration = iterationsDone;
     mTotalIterations = totalIterations;
-    return !mCancel;
+    mCountdown = 0; // so that the next processUpdate publishes
+    return !cancelled();
   }
 
-  void   cancel() { mCancel = true; }
-  void   reset() { mCancel = false; }
-  double progress() { return mProgress; }
-  bool   cancelled() { return mCancel; }
+  void   cancel() { mCancel.store(true, std::memory_order_relaxed); }
+  void   reset() { mCancel.store(false, std::memory_order_relaxed); }
+  double progress() { return mProgress.load(std::memory_order_relaxed); }
+  bool   cancelled() { return mCancel.load(std::memory_order_relaxed); }
 
 private:
+  void publish(double samplesDone, double taskLength)
+  {
+    mProgress.store((samplesDone / (taskLength * mTotalIterations)) +
+                        (mIteration / mTotalIterations),
+                    std::memory_order_relaxed);
+    const std::chrono::microseconds kPublishInterval{1000};
+    const index                     kMaxStride = 1 << 16;
+    auto                            now = Clock::now();
+    auto elapsed = now - mLastPublish;
+    if (elapsed < kPublishInterval)
+      mStride = std::min(mStride * 2, kMaxStride);
+    else if (elapsed > 4 * kPublishInterval)
+      mStride = std::max<index>(mStride / 2, 1);
+    mLastPublish = now;
+    mCountdown = mStride;
+  }
+
   std::atomic<double> mProgress;
-  bool                mCancel;
+  std::atomic<bool>   mCancel;
   double              mTotalIterations{1};
   // if a wrapped single channel RT process is being run over multiple
   // channels, progress needs reflect the total proportion, rather than
   // going 0->1 n times
   double mIteration{0};
+
+  // worker side only
+  index             mStride{1};
+  index             mCountdown{0};
+  Clock::time_point mLastPublish{};
 };
 
 } // namespace fluid
@@ -0,0 +1,85 @@
+/*
+Part of the Fluid Corpus Manipulation Project (http://www.flucoma.org/)
+Copyright 2017-2019 University of Huddersfield.
+Licensed under the BSD-3 License.
+See license.md file in the project root for full license information.
+This project has received funding from the European Research Council (ERC)
+under the European Union’s Horizon 2020 research and innovation programme
+(grant agreement No 725899).
+*/
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+
+namespace fluid {
+namespace client {
+
+/// Passes copies of a model from the thread that fits or loads it to a single
+/// real-time reader, RCU style. publish() hands over a fresh copy; acquire()
+/// swaps it in with a couple of atomic operations, never blocking, allocating
+/// or freeing. Since each copy belongs to the reader once acquired, the reader
+/// may also use non-const methods that keep scratch state in the model.
+///
+/// The model the reader swaps out is parked until the writer's next
+/// publish() or collect() frees it, and the reader won't swap again while one
+/// is parked. publish() frees it after handing over the new copy, so the first
+/// acquire() once publish() has returned always sees that copy.
+template <typename T>
+class ModelHandoff
+{
+public:
+  ModelHandoff() = default;
+  ModelHandoff(const ModelHandoff&) = delete;
+  ModelHandoff& operator=(const ModelHandoff&) = delete;
+
+  ~ModelHandoff()
+  {
+    delete mPending.load();
+    delete mRetired.load();
+    delete mCurrent;
+  }
+
+  /// Writer side
+  void publish(const T& model) { publish(std::make_unique<T>(model)); }
+
+  void publish(std::unique_ptr<T> model)
+  {
+    // a previous copy the reader never picked up is ours to free
+    delete mPending.exchange(model.release(), std::memory_order_acq_rel);
+    collect();
+  }
+
+  /// Writer side: frees the model the reader last swapped out, if any
+  void collect()
+  {
+    delete mRetired.exchange(nullptr, std::memory_order_acquire);
+  }
+
+  /// Reader side (one thread only): the newest model available, or nullptr
+  /// if nothing has been published
+  T* acquire()
+  {
+    if (mPending.load(std::memory_order_relaxed) &&
+        !mRetired.load(std::memory_order_acquire))
+    {
+      T* next = mPending.exchange(nullptr, std::memory_order_acq_rel);
+      if (next)
+      {
+        mRetired.store(mCurrent, std::memory_order_release);
+        mCurrent = next;
+      }
+    }
+    return mCurrent;
+  }
+
+private:
+  std::atomic<T*> mPending{nullptr};
+  // only the reader sets this, only the writer clears it
+  std::atomic<T*> mRetired{nullptr};
+  T*              mCurrent{nullptr};
+};
+
+} // namespace client
+} // namespace fluid
@@ -156,16 +156,15 @@ private:
     auto paddingSlice = Slice(padding, input.size());
     paddedInput(paddingSlice) = input;
 
-    FluidTensor<double, 2> tmpMags(numHops, numBins);
-    FluidTensor<double, 2> tmpPhase(numHops, numBins);
+    FluidTensor<double, 2> tmpMags(Uninitialized, numHops, numBins);
+    FluidTensor<double, 2> tmpPhase(Uninitialized, numHops, numBins);
 
-    FluidTensor<std::complex<double>, 2> tmpComplex(numHops, numBins);
+    FluidTensor<std::complex<double>, 2> tmpComplex(Uninitialized, numHops,
+                                                    numBins);
 
     auto stft = algorithm::STFT(winSize, fftSize, hopSize);
 
-    for (index i = 0; i < numHops; ++i)
-      stft.processFrame(paddedInput(Slice(i * hopSize, winSize)),
-                        tmpComplex.row(i));
+    stft.processFrames(paddedInput, 0, 0, tmpComplex, 0);
 
     if (haveMag)
     {
@@ -237,7 +236,7 @@ private:
     FluidTensor<std::complex<double>, 2> tmpComplex(tmpOut.size() / hopSize,
                                                     mags.numChans());
 
-    FluidTensor<double, 1> frame(winSize);
+    FluidTensor<double, 1> frame(Uninitialized, winSize);
 
     auto magsView = mags.allFrames().transpose();
     auto phaseView = phases.allFrames().transpose();
@@ -15,7 +15,10 @@ under the European Union’s Horizon 2020 research and innovation programme
 #include "../common/ParameterConstraints.hpp"
 #include "../common/ParameterTypes.hpp"
 #include "../../algorithms/public/MultiStats.hpp"
+#include "../../algorithms/util/ParallelFor.hpp"
 #include <algorithm>
+#include <cmath>
+#include <vector>
 
 namespace fluid {
 namespace client {
@@ -33,7 +36,8 @@ enum BufferStatsParamIndex {
   kMiddle,
   kHigh,
   kOutliersCutoff,
-  kWeights
+  kWeights,
+  kSlicePoints
 };
 
 constexpr auto BufStatsParams = defineParameters(
@@ -51,7 +55,8 @@ constexpr auto BufStatsParams = defineParameters(
     FloatParam("high", "High Percentile", 100, Min(0), Max(100),
                LowerLimit<kMiddle>()),
     FloatParam("outliersCutoff", "Outliers Cutoff", -1, Min(-1)),
-    BufferParam("weights", "Weights Buffer"));
+    BufferParam("weights", "Weights Buffer"),
+    InputBufferParam("slicePoints", "Slice Points Buffer"));
 
 class BufferStatsClient : public FluidBaseClient,
                           public OfflineIn,
@@ -124,11 +129,14 @@ public:
     if (numFrames <= get<kNumDerivatives>())
       return {Result::Status::kError, "Not enough frames"};
 
-    index  outputSize = processor.numStats() * (get<kNumDerivatives>() + 1);
-    Result resizeResult =
-        dest.resize(outputSize, numChannels, source.sampleRate());
+    index outputSize = processor.numStats() * (get<kNumDerivatives>() + 1);
 
-    if (!resizeResult.ok()) return resizeResult;
+    if (!get<kSlicePoints>())
+    {
+      Result resizeResult =
+          dest.resize(outputSize, numChannels, source.sampleRate());
+      if (!resizeResult.ok()) return resizeResult;
+    }
 
     processor.init(get<kNumDerivatives>(), get<kLow>(), get<kMiddle>(),
                    get<kHigh>());
@@ -154,11 +162,18 @@ public:
       }
       if (*std::max_element(weights.begin(), weights.end()) <= 0)
       {
-        for (index i = 0; i < numChannels; i++) dest.samps(i).fill(0);
+        for (index i = 0; i < dest.numChans(); i++) dest.samps(i).fill(0);
         return {Result::Status::kWarning, "Invalid weights"};
       }
     }
-    FluidTensor<double, 2> tmp(numChannels, numFrames);
+
+    if (get<kSlicePoints>())
+    {
+      return processSlices(source, dest, numFrames, numChannels, weights,
+                           processingResult);
+    }
+
+    FluidTensor<double, 2> tmp(Uninitialized, numChannels, numFrames);
     FluidTensor<double, 2> result(numChannels, outputSize);
     for (int i = 0; i < numChannels; i++)
     {
@@ -169,6 +184,98 @@ public:
     for (int i = 0; i < numChannels; i++) { dest.samps(i) = result.row(i); }
     return processingResult;
   }
+
+private:
+  // Stats for every slice [p(k), p(k + 1)) between consecutive slice points
+  // (source frames, clipped to the analysed range), and for the tail from the
+  // last point to the end of the range, computed in parallel from a single
+  // read of the source. The layout is that of a plain BufStats call per
+  // slice, with the slices' channels one after another: slice k's stats for
+  // source channel i are in destination channel k * numChans + i
+  Result processSlices(BufferAdaptor::ReadAccess& source,
+                       BufferAdaptor::Access& dest, index numFrames,
+                       index numChannels, RealVector& weights,
+                       Result processingResult)
+  {
+    using namespace algorithm;
+    BufferAdaptor::ReadAccess points(get<kSlicePoints>().get());
+    if (!points.exists() || !points.valid())
+      return {Result::Status::kError, "Slice points buffer not found"};
+    index numPoints = points.numFrames();
+    if (numPoints < 1)
+      return {Result::Status::kError, "No slice points"};
+
+    index              offset = get<kOffset>();
+    std::vector<index> bounds(asUnsigned(numPoints));
+    auto               pointsView = points.samps(0);
+    for (index k = 0; k < numPoints; k++)
+    {
+      index point = static_cast<index>(std::lrint(pointsView(k))) - offset;
+      bounds[asUnsigned(k)] = std::min(std::max<index>(point, 0), numFrames);
+      if (k > 0 && bounds[asUnsigned(k)] < bounds[asUnsigned(k - 1)])
+        return {Result::Status::kError, "Slice points not in ascending order"};
+    }
+    if (bounds.back() < numFrames) bounds.push_back(numFrames);
+
+    index numDerivatives = get<kNumDerivatives>();
+    index numSlices = asSigned(bounds.size()) - 1;
+    if (numSlices < 1)
+      return {Result::Status::kError, "Slice points leave nothing to analyse"};
+    index statsSize = MultiStats().numStats() * (numDerivatives + 1);
+    Result resizeResult =
+        dest.resize(statsSize, numSlices * numChannels, source.sampleRate());
+    if (!resizeResult.ok()) return resizeResult;
+
+    FluidTensor<double, 2> data(Uninitialized, numChannels, numFrames);
+    for (index i = 0; i < numChannels; i++)
+    {
+      data.row(i) =
+          source.samps(get<kOffset>(), numFrames, get<kStartChan>() + i);
+    }
+
+    FluidTensor<double, 3> result(numSlices, numChannels, statsSize);
+    index workers = numWorkers(numSlices, kMinSlicesPerWorker);
+    std::vector<MultiStats> processors(asUnsigned(workers));
+    std::vector<index>      shortSlices(asUnsigned(workers), 0);
+    for (auto& p : processors)
+    {
+      p.init(numDerivatives, get<kLow>(), get<kMiddle>(), get<kHigh>());
+      p.setMaxThreads(1);
+    }
+
+    parallelFor(numSlices, workers, [&](index begin, index end, index id) {
+      MultiStats& processor = processors[asUnsigned(id)];
+      for (index k = begin; k < end; k++)
+      {
+        index start = bounds[asUnsigned(k)];
+        index length = bounds[asUnsigned(k + 1)] - start;
+        if (length <= numDerivatives)
+        {
+          shortSlices[asUnsigned(id)]++;
+          continue;
+        }
+        processor.process(data(Slice(0), Slice(start, length)), result.row(k),
+                          get<kOutliersCutoff>(),
+                          weights.size() > 0
+                              ? weights(Slice(start, length))
+                              : RealVectorView(nullptr, 0, 0));
+      }
+    });
+
+    for (index k = 0; k < numSlices; k++)
+      for (index i = 0; i < numChannels; i++)
+        dest.samps(k * numChannels + i) = result.row(k).row(i);
+
+    index numShort = 0;
+    for (auto n : shortSlices) numShort += n;
+    if (numShort > 0)
+      return {Result::Status::kWarning, numShort,
+              " slices too short for the requested derivatives"};
+    return processingResult;
+  }
+
+  // slices are usually short, so give each thread a reasonable batch
+  static constexpr index kMinSlicesPerWorker = 16;
 };
 } // namespace bufstats
 
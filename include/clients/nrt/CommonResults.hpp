@@ -32,6 +32,7 @@ static const std::string EmptyLabelSet{"LabelSet is empty"};
 static const std::string NoDataSet{"DataSet does not exist"};
 static const std::string NoLabelSet{"LabelSet does not exist"};
 static const std::string NoDataFitted{"No data fitted"};
+static const std::string NoFitCount{"Fit was saved without a point count"};
 static const std::string NotEnoughData{"Not enough data"};
 static const std::string EmptyLabel{"Empty label"};
 static const std::string EmptyId{"Empty id"};
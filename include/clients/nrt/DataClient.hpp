@@ -10,6 +10,7 @@ under the European Union’s Horizon 2020 research and innovation programme
 
 #pragma once
 #include "NRTClient.hpp"
+#include "../common/ModelHandoff.hpp"
 #include "../common/SharedClientUtils.hpp"
 #include "../../data/FluidDataSet.hpp"
 #include "../../data/FluidJSON.hpp"
@@ -34,6 +35,7 @@ public:
   MessageResult<void> clear()
   {
     mAlgorithm.clear();
+    publishModel();
     return OK();
   }
 
@@ -54,6 +56,7 @@ public:
     {
       if (!check_json(j, mAlgorithm)) return Error("Invalid JSON format");
       mAlgorithm = j.get<T>();
+      publishModel();
     }
     return OK();
   }
@@ -76,12 +79,35 @@ public:
     {
       if (!check_json(j, mAlgorithm)) return Error("Invalid JSON format");
       mAlgorithm = j.get<T>();
+      publishModel();
       return OK();
     }
   }
 
 protected:
+  // For clients whose process() uses the model on the audio thread while
+  // messages change it: call enableModelHandoff() in the constructor and
+  // publishModel() after changing mAlgorithm outside clear/read/load, and use
+  // handoffModel() rather than mAlgorithm in process()
+  void enableModelHandoff()
+  {
+    mHandoffEnabled = true;
+    publishModel();
+  }
+
+  void publishModel()
+  {
+    if (mHandoffEnabled) mHandoff.publish(mAlgorithm);
+  }
+
+  // Audio thread only: a private copy of the latest published model
+  T& handoffModel() { return *mHandoff.acquire(); }
+
   T mAlgorithm;
+
+private:
+  ModelHandoff<T> mHandoff;
+  bool            mHandoffEnabled{false};
 };
 
 } // namespace client
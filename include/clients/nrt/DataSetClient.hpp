@@ -217,7 +217,7 @@ public:
   }
 
   const DataSet getDataSet() const { return mAlgorithm; }
-  void          setDataSet(DataSet ds) { mAlgorithm = ds; }
+  void          setDataSet(DataSet ds) { mAlgorithm = std::move(ds); }
 
   static auto getMessageDescriptors()
   {
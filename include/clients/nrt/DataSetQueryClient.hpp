@@ -114,7 +114,7 @@ public:
     DataSet empty;
     DataSet result(resultSize);
     mAlgorithm.process(src, empty, result);
-    destPtr->setDataSet(result);
+    destPtr->setDataSet(std::move(result));
     return OK();
   }
 
@@ -134,7 +134,7 @@ public:
     if (src2.size() == 0) return Error(EmptyDataSet);
     DataSet result(mAlgorithm.numColumns() + src2.pointSize());
     mAlgorithm.process(src1, src2, result);
-    destPtr->setDataSet(result);
+    destPtr->setDataSet(std::move(result));
     return OK();
   }
 
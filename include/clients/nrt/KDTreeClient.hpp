@@ -12,27 +12,37 @@ under the European Union’s Horizon 2020 research and innovation programme
 
 #include "DataSetClient.hpp"
 #include "NRTClient.hpp"
-#include "../../algorithms/public/KDTree.hpp"
+#include "../../algorithms/public/NeighbourIndex.hpp"
 #include <string>
 
 namespace fluid {
 namespace client {
 namespace kdtree {
 
-enum { kNumNeighbors, kRadius, kDataSet, kInputBuffer, kOutputBuffer };
+enum {
+  kNumNeighbors,
+  kRadius,
+  kDataSet,
+  kInputBuffer,
+  kOutputBuffer,
+  kSearchIndex,
+  kSearchWidth
+};
 
 constexpr auto KDTreeParams = defineParameters(
     LongParam("numNeighbours", "Number of Nearest Neighbours", 1),
     FloatParam("radius", "Maximum distance", 0, Min(0)),
     DataSetClientRef::makeParam("dataSet", "DataSet Name"),
     BufferParam("inputPointBuffer", "Input Point Buffer"),
-    BufferParam("predictionBuffer", "Prediction Buffer"));
+    BufferParam("predictionBuffer", "Prediction Buffer"),
+    EnumParam("searchIndex", "Search Index", 0, "KDTree", "HNSW"),
+    LongParam("searchWidth", "HNSW Search Width", 50, Min(1)));
 
 class KDTreeClient : public FluidBaseClient,
                      AudioIn,
                      ControlOut,
                      ModelObject,
-                     public DataClient<algorithm::KDTree>
+                     public DataClient<algorithm::NeighbourIndex>
 {
 public:
   using string = std::string;
@@ -57,16 +67,18 @@ public:
   {
     audioChannelsIn(1);
     controlChannelsOut(1);
+    enableModelHandoff();
   }
 
   template <typename T>
   void process(std::vector<FluidTensorView<T, 1>>& input,
                std::vector<FluidTensorView<T, 1>>& output, FluidContext&)
   {
+    auto& model = handoffModel();
     index k = get<kNumNeighbors>();
-    if (!mAlgorithm.initialized()) return;
-    if (k > mAlgorithm.size() || k <= 0) return;
-    InOutBuffersCheck bufCheck(mAlgorithm.dims());
+    if (!model.initialized()) return;
+    if (k > model.size() || k <= 0) return;
+    InOutBuffersCheck bufCheck(model.dims());
     if (!bufCheck.checkInputs(get<kInputBuffer>().get(),
                               get<kOutputBuffer>().get()))
       return;
@@ -80,15 +92,15 @@ public:
       index outputSize = k * pointSize;
       if (outBuf.samps(0).size() < outputSize) return;
 
-      RealVector point(mAlgorithm.dims());
+      RealVector point(model.dims());
       point = BufferAdaptor::ReadAccess(get<kInputBuffer>().get())
-                  .samps(0, mAlgorithm.dims(), 0);
+                  .samps(0, model.dims(), 0);
       if (mRTBuffer.size() != outputSize)
       {
         mRTBuffer = RealVector(outputSize);
         mRTBuffer.fill(0);
       }
-      auto nearest = mAlgorithm.kNearest(point, k);
+      auto nearest = model.kNearest(point, k, 0, get<kSearchWidth>());
       auto ids = nearest.getIds();
       for (index i = 0; i < k; i++)
       { dataset.get(ids(i), mRTBuffer(Slice(i * pointSize, pointSize))); }
@@ -105,7 +117,8 @@ public:
     if (!datasetClientPtr) return Error(NoDataSet);
     auto dataset = datasetClientPtr->getDataSet();
     if (dataset.size() == 0) return Error(EmptyDataSet);
-    mAlgorithm = algorithm::KDTree(dataset);
+    mAlgorithm = algorithm::NeighbourIndex(dataset, get<kSearchIndex>());
+    publishModel();
     return OK();
   }
 
@@ -122,7 +135,7 @@ public:
     point =
         BufferAdaptor::ReadAccess(data.get()).samps(0, mAlgorithm.dims(), 0);
     FluidDataSet<std::string, double, 1> nearest =
-        mAlgorithm.kNearest(point, k, get<kRadius>());
+        mAlgorithm.kNearest(point, k, get<kRadius>(), get<kSearchWidth>());
     StringVector result{nearest.getIds()};
     return result;
   }
@@ -141,7 +154,7 @@ public:
     point =
         BufferAdaptor::ReadAccess(data.get()).samps(0, mAlgorithm.dims(), 0);
     FluidDataSet<std::string, double, 1> nearest =
-        mAlgorithm.kNearest(point, k, get<kRadius>());
+        mAlgorithm.kNearest(point, k, get<kRadius>(), get<kSearchWidth>());
     RealVector result{nearest.getData().col(0)};
     return result;
   }
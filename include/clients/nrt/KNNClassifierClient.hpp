@@ -15,18 +15,33 @@ under the European Union’s Horizon 2020 research and innovation programme
 #include "LabelSetClient.hpp"
 #include "../../algorithms/public/LabelSetEncoder.hpp"
 #include "../../algorithms/public/KNNClassifier.hpp"
+#include "../../algorithms/public/NeighbourIndex.hpp"
 
 namespace fluid {
 namespace client {
 namespace knnclassifier{
 
 struct KNNClassifierData{
-  algorithm::KDTree tree{0};
+  algorithm::NeighbourIndex tree;
   FluidDataSet<std::string, std::string, 1> labels{1};
+  // derived from tree and labels, not serialised
+  algorithm::LabelSetEncoder encoder;
+  FluidTensor<index, 1> labelCodes;
   index size(){return labels.size();}
   index dims(){return tree.dims();}
-  void clear(){labels = FluidDataSet<std::string, std::string, 1>(1);tree.clear();}
+  void clear(){
+    labels = FluidDataSet<std::string, std::string, 1>(1);
+    tree.clear();
+    encoder.clear();
+    labelCodes = FluidTensor<index, 1>();
+  }
   bool initialized() const{return tree.initialized();}
+  void encodeLabels(){
+    encoder.clear();
+    encoder.fit(labels);
+    labelCodes = FluidTensor<index, 1>(tree.size());
+    encoder.encodeIds(labels, tree.ids(), labelCodes);
+  }
 };
 
 void to_json(nlohmann::json& j, const KNNClassifierData& data) {
@@ -37,21 +52,31 @@ void to_json(nlohmann::json& j, const KNNClassifierData& data) {
 bool check_json(const nlohmann::json& j, const KNNClassifierData&){
   return fluid::check_json(j,
     {"tree", "labels"}, {JSONTypes::OBJECT, JSONTypes::OBJECT}
-  );
+  ) && check_json(j.at("tree"), algorithm::NeighbourIndex());
 }
 
 void from_json(const nlohmann::json& j, KNNClassifierData& data) {
-  data.tree = j.at("tree").get<algorithm::KDTree>();
+  data.tree = j.at("tree").get<algorithm::NeighbourIndex>();
   data.labels = j.at("labels").get<FluidDataSet<std::string, std::string, 1>>();
+  data.encodeLabels();
 }
 
-enum { kNumNeighbors, kWeight, kInputBuffer, kOutputBuffer };
+enum {
+  kNumNeighbors,
+  kWeight,
+  kInputBuffer,
+  kOutputBuffer,
+  kSearchIndex,
+  kSearchWidth
+};
 
 constexpr auto KNNClassifierParams = defineParameters(
     LongParam("numNeighbours", "Number of Nearest Neighbours", 3, Min(1)),
     EnumParam("weight", "Weight Neighbours by Distance", 1, "No", "Yes"),
     BufferParam("inputPointBuffer", "Input Point Buffer"),
-    BufferParam("predictionBuffer", "Prediction Buffer"));
+    BufferParam("predictionBuffer", "Prediction Buffer"),
+    EnumParam("searchIndex", "Search Index", 0, "KDTree", "HNSW"),
+    LongParam("searchWidth", "HNSW Search Width", 50, Min(1)));
 
 class KNNClassifierClient : public FluidBaseClient,
                      AudioIn,
@@ -88,28 +113,32 @@ public:
   {
     audioChannelsIn(1);
     controlChannelsOut(1);
+    enableModelHandoff();
   }
 
   template <typename T>
   void process(std::vector<FluidTensorView<T, 1>> &input,
                std::vector<FluidTensorView<T, 1>> &output, FluidContext &)
   {
+    auto& model = handoffModel();
     index k = get<kNumNeighbors>();
     bool weight = get<kWeight>() != 0;
-    if(k == 0 || mAlgorithm.tree.size() == 0 || mAlgorithm.tree.size() < k) return;
-    InOutBuffersCheck bufCheck(mAlgorithm.tree.dims());
+    if(k == 0 || model.tree.size() == 0 || model.tree.size() < k) return;
+    InOutBuffersCheck bufCheck(model.tree.dims());
     if(!bufCheck.checkInputs(
       get<kInputBuffer>().get(),
       get<kOutputBuffer>().get()))
       return;
     auto outBuf = BufferAdaptor::Access(get<kOutputBuffer>().get());
     if(outBuf.samps(0).size() != 1) return;
-    algorithm::KNNClassifier classifier;
-    RealVector point(mAlgorithm.tree.dims());
-    point = BufferAdaptor::ReadAccess(get<kInputBuffer>().get()).samps(0, mAlgorithm.tree.dims(), 0);
+    if(mPoint.size() != model.tree.dims())
+      mPoint = RealVector(model.tree.dims());
+    mPoint = BufferAdaptor::ReadAccess(get<kInputBuffer>().get()).samps(0, model.tree.dims(), 0);
+    mClassifier.setSearchWidth(get<kSearchWidth>());
     mTrigger.process(input, output, [&](){
-      std::string result = classifier.predict(mAlgorithm.tree, point, mAlgorithm.labels, k, weight);
-      outBuf.samps(0)[0] = static_cast<double>(mLabelSetEncoder.encodeIndex(result));
+      index result = mClassifier.predict(model.tree, mPoint,
+          model.labelCodes, model.encoder.numLabels(), k, weight);
+      outBuf.samps(0)[0] = static_cast<double>(result);
     });
   }
 
@@ -126,10 +155,11 @@ public:
     auto labelSet = labelsetPtr->getLabelSet();
     if (labelSet.size() == 0) return Error(EmptyLabelSet);
     if(dataset.size() != labelSet.size()) return Error(SizesDontMatch);
-    mAlgorithm.tree = algorithm::KDTree{dataset};
+    mAlgorithm.tree =
+        algorithm::NeighbourIndex{dataset, get<kSearchIndex>()};
     mAlgorithm.labels = labelSet;
-    mAlgorithm = {mAlgorithm.tree, mAlgorithm.labels};
-    mLabelSetEncoder.fit(mAlgorithm.labels);
+    mAlgorithm.encodeLabels();
+    publishModel();
     return OK();
   }
 
@@ -144,10 +174,12 @@ public:
     InBufferCheck bufCheck(mAlgorithm.tree.dims());
     if(!bufCheck.checkInputs(data.get())) return Error<string>(bufCheck.error());
     algorithm::KNNClassifier classifier;
+    classifier.setSearchWidth(get<kSearchWidth>());
     RealVector point(mAlgorithm.tree.dims());
     point = BufferAdaptor::ReadAccess(data.get()).samps(0, mAlgorithm.tree.dims(), 0);
-    std::string result = classifier.predict(mAlgorithm.tree, point, mAlgorithm.labels, k, weight);
-    return result;
+    index result = classifier.predict(mAlgorithm.tree, point,
+        mAlgorithm.labelCodes, mAlgorithm.encoder.numLabels(), k, weight);
+    return mAlgorithm.encoder.decodeIndex(result);
   }
 
   MessageResult<void> predict(
@@ -168,17 +200,16 @@ public:
     if (mAlgorithm.tree.size() < k) return Error(NotEnoughData);
 
     algorithm::KNNClassifier classifier;
-    auto ids = dataSet.getIds();
-    auto data = dataSet.getData();
-    LabelSet result(1);
-    for (index i = 0; i < dataSet.size(); i++) {
-      RealVectorView point = data.row(i);
-      StringVector label = {
-        classifier.predict(mAlgorithm.tree, point, mAlgorithm.labels, k, weight)
-      };
-      result.add(ids(i), label);
-    }
-    destPtr->setLabelSet(result);
+    classifier.setSearchWidth(get<kSearchWidth>());
+    FluidTensor<index, 1> codes(dataSet.size());
+    classifier.predict(mAlgorithm.tree, dataSet.getData(),
+        mAlgorithm.labelCodes, mAlgorithm.encoder.numLabels(), codes, k,
+        weight);
+    FluidTensor<string, 2> labels(dataSet.size(), 1);
+    for (index i = 0; i < dataSet.size(); i++)
+      labels(i, 0) = mAlgorithm.encoder.decodeIndex(codes(i));
+    LabelSet result(StringVector(dataSet.getIds()), std::move(labels));
+    destPtr->setLabelSet(std::move(result));
     return OK();
   }
   index latency() { return 0; }
@@ -200,7 +231,8 @@ public:
 
 private:
   FluidInputTrigger mTrigger;
-  algorithm::LabelSetEncoder mLabelSetEncoder;
+  algorithm::KNNClassifier mClassifier;
+  RealVector mPoint;
 };
 }
 
@@ -13,18 +13,28 @@ under the European Union’s Horizon 2020 research and innovation programme
 #include "DataSetClient.hpp"
 #include "NRTClient.hpp"
 #include "../../algorithms/public/KNNRegressor.hpp"
+#include "../../algorithms/public/NeighbourIndex.hpp"
 
 namespace fluid {
 namespace client {
 namespace knnregressor{
 
 struct KNNRegressorData {
-  algorithm::KDTree tree{0};
+  algorithm::NeighbourIndex tree;
   FluidDataSet<std::string, double, 1> target{1};
+  // targets by tree position, derived from tree and target, not serialised
+  RealVector targetValues;
   index size() { return target.size(); }
   index dims() { return tree.dims(); }
-  void clear(){tree.clear();target = FluidDataSet<std::string, double, 1> ();}
+  void clear(){
+    tree.clear();
+    target = FluidDataSet<std::string, double, 1> ();
+    targetValues = RealVector();
+  }
   bool initialized() const{return tree.initialized();}
+  void updateTargets(){
+    targetValues = algorithm::KNNRegressor::targetTable(tree, target);
+  }
 };
 
 void to_json(nlohmann::json &j, const KNNRegressorData &data) {
@@ -34,21 +44,32 @@ void to_json(nlohmann::json &j, const KNNRegressorData &data) {
 
 bool check_json(const nlohmann::json &j, const KNNRegressorData &) {
   return fluid::check_json(j, {"tree", "target"},
-                           {JSONTypes::OBJECT, JSONTypes::OBJECT});
+                           {JSONTypes::OBJECT, JSONTypes::OBJECT}) &&
+         check_json(j.at("tree"), algorithm::NeighbourIndex());
 }
 
 void from_json(const nlohmann::json &j, KNNRegressorData &data) {
-  data.tree = j["tree"].get<algorithm::KDTree>();
+  data.tree = j["tree"].get<algorithm::NeighbourIndex>();
   data.target = j["target"].get<FluidDataSet<std::string, double, 1>>();
+  data.updateTargets();
 }
 
-enum { kNumNeighbors, kWeight, kInputBuffer, kOutputBuffer };
+enum {
+  kNumNeighbors,
+  kWeight,
+  kInputBuffer,
+  kOutputBuffer,
+  kSearchIndex,
+  kSearchWidth
+};
 
 constexpr auto KNNRegressorParams = defineParameters(
     LongParam("numNeighbours", "Number of Nearest Neighbours", 3, Min(1)),
     EnumParam("weight", "Weight Neighbours by Distance", 1, "No", "Yes"),
     BufferParam("inputPointBuffer", "Input Point Buffer"),
-    BufferParam("predictionBuffer", "Prediction Buffer"));
+    BufferParam("predictionBuffer", "Prediction Buffer"),
+    EnumParam("searchIndex", "Search Index", 0, "KDTree", "HNSW"),
+    LongParam("searchWidth", "HNSW Search Width", 50, Min(1)));
 
 class KNNRegressorClient : public FluidBaseClient,
                            AudioIn,
@@ -82,27 +103,31 @@ public:
   KNNRegressorClient(ParamSetViewType &p) : mParams(p) {
     audioChannelsIn(1);
     controlChannelsOut(1);
+    enableModelHandoff();
   }
 
   template <typename T>
   void process(std::vector<FluidTensorView<T, 1>> &input,
                std::vector<FluidTensorView<T, 1>> &output, FluidContext &) {
+    auto& model = handoffModel();
     index k = get<kNumNeighbors>();
     bool weight = get<kWeight>() != 0;
-    if (k == 0 || mAlgorithm.tree.size() == 0 || mAlgorithm.tree.size() < k)
+    if (k == 0 || model.tree.size() == 0 || model.tree.size() < k)
       return;
-    InOutBuffersCheck bufCheck(mAlgorithm.tree.dims());
+    InOutBuffersCheck bufCheck(model.tree.dims());
     if (!bufCheck.checkInputs(get<kInputBuffer>().get(),
                               get<kOutputBuffer>().get()))
       return;
     auto outBuf = BufferAdaptor::Access(get<kOutputBuffer>().get());
     if(outBuf.samps(0).size() != 1) return;
 
-    algorithm::KNNRegressor regressor;
-    RealVector point(mAlgorithm.tree.dims());
-    point = BufferAdaptor::ReadAccess(get<kInputBuffer>().get()).samps(0, mAlgorithm.tree.dims(), 0);
+    if (mPoint.size() != model.tree.dims())
+      mPoint = RealVector(model.tree.dims());
+    mPoint = BufferAdaptor::ReadAccess(get<kInputBuffer>().get()).samps(0, model.tree.dims(), 0);
+    mRegressor.setSearchWidth(get<kSearchWidth>());
     mTrigger.process(input, output, [&]() {
-      double result = regressor.predict(mAlgorithm.tree, mAlgorithm.target, point, k, weight);
+      double result = mRegressor.predict(model.tree,
+          model.targetValues, mPoint, k, weight);
       outBuf.samps(0)[0] = result;
     });
   }
@@ -125,9 +150,11 @@ public:
       return Error<string>(EmptyDataSet);
     if (dataSet.size() != target.size())
       return Error<string>(SizesDontMatch);
-    mAlgorithm.tree = algorithm::KDTree{dataSet};
+    mAlgorithm.tree =
+        algorithm::NeighbourIndex{dataSet, get<kSearchIndex>()};
     mAlgorithm.target = target;
-    mAlgorithm = {mAlgorithm.tree, mAlgorithm.target};
+    mAlgorithm.updateTargets();
+    publishModel();
     return {};
   }
 
@@ -141,9 +168,11 @@ public:
     if (!bufCheck.checkInputs(data.get()))
       return Error<double>(bufCheck.error());
     algorithm::KNNRegressor regressor;
+    regressor.setSearchWidth(get<kSearchWidth>());
     RealVector point(mAlgorithm.tree.dims());
     point = BufferAdaptor::ReadAccess(data.get()).samps(0, mAlgorithm.tree.dims(), 0);
-    double result = regressor.predict(mAlgorithm.tree, mAlgorithm.target, point, k, weight);
+    double result = regressor.predict(mAlgorithm.tree,
+        mAlgorithm.targetValues, point, k, weight);
     return result;
   }
 
@@ -162,17 +191,12 @@ public:
     if (mAlgorithm.tree.size() < k) return Error(NotEnoughData);
 
     algorithm::KNNRegressor regressor;
-    auto ids = dataSet.getIds();
-    auto data = dataSet.getData();
-    DataSet result(1);
-    for (index i = 0; i < dataSet.size(); i++) {
-      RealVectorView point = data.row(i);
-      RealVector prediction = {
-        regressor.predict(mAlgorithm.tree, mAlgorithm.target, point, k, weight)
-      };
-      result.add(ids(i), prediction);
-    }
-    destPtr->setDataSet(result);
+    regressor.setSearchWidth(get<kSearchWidth>());
+    RealMatrix predictions(dataSet.size(), 1);
+    regressor.predict(mAlgorithm.tree, mAlgorithm.targetValues,
+        dataSet.getData(), predictions.col(0), k, weight);
+    DataSet result(StringVector(dataSet.getIds()), std::move(predictions));
+    destPtr->setDataSet(std::move(result));
     return OK();
   }
 
@@ -193,6 +217,8 @@ public:
 
 private:
   FluidInputTrigger mTrigger;
+  algorithm::KNNRegressor mRegressor;
+  RealVector mPoint;
 };
 } // namespace knnregressor
 
@@ -115,7 +115,7 @@ public:
   }
 
   const LabelSet getLabelSet() const { return mAlgorithm; }
-  void           setLabelSet(LabelSet ls) { mAlgorithm = ls; }
+  void           setLabelSet(LabelSet ls) { mAlgorithm = std::move(ls); }
 };
 } // namespace labelset
 
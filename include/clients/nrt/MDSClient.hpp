@@ -18,13 +18,15 @@ namespace fluid {
 namespace client {
 namespace mds {
 
-enum { kNumDimensions, kDistance };
+enum { kNumDimensions, kDistance, kMethod, kNumLandmarks };
 
 constexpr auto MDSParams = defineParameters(
     LongParam("numDimensions", "Target Number of Dimensions", 2, Min(1)),
     EnumParam("distanceMetric", "Distance Metric", 1, "Manhattan", "Euclidean",
               "Squared Euclidean", "Max Distance", "Min Distance",
-              "KL Divergence"));
+              "KL Divergence"),
+    EnumParam("method", "Solver Method", 0, "Exact", "Partial", "Landmark"),
+    LongParam("numLandmarks", "Number of Landmarks", 1000, Min(2)));
 
 class MDSClient : public FluidBaseClient, OfflineIn, OfflineOut, ModelObject
 {
@@ -62,6 +64,7 @@ public:
   {
     index k = get<kNumDimensions>();
     index dist = get<kDistance>();
+    index numLandmarks = get<kNumLandmarks>();
     auto  srcPtr = sourceClient.get().lock();
     auto  destPtr = destClient.get().lock();
     if (!srcPtr || !destPtr) return Error(NoDataSet);
@@ -70,10 +73,13 @@ public:
     if (src.size() == 0) return Error(EmptyDataSet);
     if (k <= 0) return Error(SmallK);
     if (dist < 0 || dist > 6) return Error("dist should be  between 0 and 6");
+    if (get<kMethod>() == 2 && numLandmarks <= k)
+      return Error("numLandmarks should be greater than numDimensions");
 
     StringVector ids{src.getIds()};
     RealMatrix   output(src.size(), k);
-    mAlgorithm.process(src.getData(), output, dist, k);
+    mAlgorithm.process(src.getData(), output, dist, k, get<kMethod>(),
+                       numLandmarks);
     FluidDataSet<string, double, 1> result(ids, output);
     destPtr->setDataSet(result);
     return OK();
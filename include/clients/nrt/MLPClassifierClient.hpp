@@ -117,15 +117,17 @@ public:
   {
     audioChannelsIn(1);
     controlChannelsOut(1);
+    enableModelHandoff();
   }
 
   template <typename T>
   void process(std::vector<FluidTensorView<T, 1>>& input,
                std::vector<FluidTensorView<T, 1>>& output, FluidContext&)
   {
-    if (!mAlgorithm.mlp.trained()) return;
-    index dims = mAlgorithm.mlp.dims();
-    index layer = mAlgorithm.mlp.size();
+    auto& model = handoffModel();
+    if (!model.mlp.trained()) return;
+    index dims = model.mlp.dims();
+    index layer = model.mlp.size();
 
     InOutBuffersCheck bufCheck(dims);
     if (!bufCheck.checkInputs(get<kInputBuffer>().get(),
@@ -135,14 +137,14 @@ public:
     if (outBuf.samps(0).size() != 1) return;
 
     RealVector src(dims);
-    RealVector dest(mAlgorithm.mlp.outputSize(layer));
+    RealVector dest(model.mlp.outputSize(layer));
     src =
         BufferAdaptor::ReadAccess(get<kInputBuffer>().get()).samps(0, dims, 0);
     mTrigger.process(input, output, [&]() {
-      mAlgorithm.mlp.processFrame(src, dest, 0, layer);
-      auto label = mAlgorithm.encoder.decodeOneHot(dest);
+      model.mlp.processFrame(src, dest, 0, layer);
+      auto label = model.encoder.decodeOneHot(dest);
       outBuf.samps(0)[0] =
-          static_cast<double>(mAlgorithm.encoder.encodeIndex(label));
+          static_cast<double>(model.encoder.encodeIndex(label));
     });
   }
 
@@ -186,7 +188,7 @@ public:
     double         error =
         sgd.train(mAlgorithm.mlp, data, oneHot, get<kIter>(), get<kBatchSize>(),
                   get<kRate>(), get<kMomentum>(), get<kVal>());
-
+    publishModel();
     return error;
   }
 
@@ -87,22 +87,24 @@ public:
   MLPRegressorClient(ParamSetViewType &p) : mParams(p) {
     audioChannelsIn(1);
     controlChannelsOut(1);
+    enableModelHandoff();
   }
 
   template <typename T>
   void process(std::vector<FluidTensorView<T, 1>> &input,
                std::vector<FluidTensorView<T, 1>> &output, FluidContext &) {
-    if (!mAlgorithm.trained())
+    auto& model = handoffModel();
+    if (!model.trained())
       return;
     index inputTap = get<kInputTap>();
     index outputTap = get<kOutputTap>();
-    if(inputTap >= mAlgorithm.size() - 1) return;
-    if(outputTap >= mAlgorithm.size()) return;
+    if(inputTap >= model.size() - 1) return;
+    if(outputTap >= model.size()) return;
     if(outputTap == 0) return;
-    if(outputTap == -1) outputTap = mAlgorithm.size();
+    if(outputTap == -1) outputTap = model.size();
 
-    index inputSize = mAlgorithm.inputSize(inputTap);
-    index outputSize = mAlgorithm.outputSize(outputTap);
+    index inputSize = model.inputSize(inputTap);
+    index outputSize = model.outputSize(outputTap);
 
     InOutBuffersCheck bufCheck(inputSize);
     if (!bufCheck.checkInputs(get<kInputBuffer>().get(),
@@ -116,7 +118,7 @@ public:
     src =
         BufferAdaptor::ReadAccess(get<kInputBuffer>().get()).samps(0, inputSize, 0);
     mTrigger.process(input, output, [&]() {
-      mAlgorithm.processFrame(src, dest, inputTap, outputTap);
+      model.processFrame(src, dest, inputTap, outputTap);
       outBuf.samps(0, outputSize, 0) = dest;
     });
   }
@@ -153,6 +155,7 @@ public:
     double error =
         sgd.train(mAlgorithm, data, tgt, get<kIter>(), get<kBatchSize>(),
                   get<kRate>(), get<kMomentum>(), get<kVal>());
+    publishModel();
     return error;
   }
 
@@ -196,14 +196,18 @@ public:
     auto stft = algorithm::STFT(fftParams.winSize(), fftParams.fftSize(),
                                 fftParams.hopSize());
 
-    auto tmp = FluidTensor<double, 1>(nFrames);
+    auto tmp = FluidTensor<double, 1>(Uninitialized, nFrames);
     auto seededFilters = FluidTensor<double, 2>(0, 0);
     auto seededEnvelopes = FluidTensor<double, 2>(0, 0);
-    auto outputFilters = FluidTensor<double, 2>(get<kRank>(), nBins);
-    auto outputEnvelopes = FluidTensor<double, 2>(nWindows, get<kRank>());
-    auto spectrum = FluidTensor<std::complex<double>, 2>(nWindows, nBins);
-    auto magnitude = FluidTensor<double, 2>(nWindows, nBins);
-    auto outputMags = FluidTensor<double, 2>(nWindows, nBins);
+    // all overwritten in full for each channel
+    auto outputFilters =
+        FluidTensor<double, 2>(Uninitialized, get<kRank>(), nBins);
+    auto outputEnvelopes =
+        FluidTensor<double, 2>(Uninitialized, nWindows, get<kRank>());
+    auto spectrum =
+        FluidTensor<std::complex<double>, 2>(Uninitialized, nWindows, nBins);
+    auto magnitude = FluidTensor<double, 2>(Uninitialized, nWindows, nBins);
+    auto outputMags = FluidTensor<double, 2>(Uninitialized, nWindows, nBins);
 
     if (seedFilters || fixFilters) seededFilters.resize(get<kRank>(), nBins);
     if (seedEnvelopes || fixEnvelopes)
@@ -221,8 +225,11 @@ public:
         return {Result::Status::kCancelled, ""};
       //          tmp = sourceData.col(i);
       tmp = source.samps(get<kOffset>(), nFrames, get<kStartChan>() + i);
-      stft.process(tmp, spectrum);
-      algorithm::STFT::magnitude(spectrum, magnitude);
+      {
+        auto timer = c.time("stft");
+        stft.process(tmp, spectrum, 0);
+        algorithm::STFT::magnitude(spectrum, magnitude);
+      }
       int progressCount{0};
       // For multichannel dictionaries, seed data could be all over the place,
       // so we'll build it up by hand :-/
@@ -248,9 +255,12 @@ public:
                                   static_cast<double>(progressTotal))
                             : true;
           });
-      nmf.process(magnitude, outputFilters, outputEnvelopes, outputMags,
-                  get<kRank>(), get<kIterations>(), !fixFilters, !fixEnvelopes,
-                  seededFilters, seededEnvelopes);
+      {
+        auto timer = c.time("solver");
+        nmf.process(magnitude, outputFilters, outputEnvelopes, outputMags,
+                    get<kRank>(), get<kIterations>(), !fixFilters,
+                    !fixEnvelopes, seededFilters, seededEnvelopes);
+      }
 
       if (c.task() && c.task()->cancelled())
         return {Result::Status::kCancelled, ""};
@@ -285,12 +295,13 @@ public:
       {
         auto mask = algorithm::RatioMask();
         mask.init(outputMags);
-        auto resynthMags = FluidTensor<double, 2>(nWindows, nBins);
-        auto resynthSpectrum =
-            FluidTensor<std::complex<double>, 2>(nWindows, nBins);
+        auto resynthMags =
+            FluidTensor<double, 2>(Uninitialized, nWindows, nBins);
+        auto resynthSpectrum = FluidTensor<std::complex<double>, 2>(
+            Uninitialized, nWindows, nBins);
         auto istft = algorithm::ISTFT{fftParams.winSize(), fftParams.fftSize(),
                                       fftParams.hopSize()};
-        auto resynthAudio = FluidTensor<double, 1>(nFrames);
+        auto resynthAudio = FluidTensor<double, 1>(Uninitialized, nFrames);
         auto resynth = BufferAdaptor::Access{get<kResynth>().get()};
 
         // const index subProgress = 3 * get<kRank>();
@@ -306,7 +317,10 @@ public:
           if (c.task() &&
               !c.task()->processUpdate(++progressCount, progressTotal))
             return {Result::Status::kCancelled, ""};
-          istft.process(resynthSpectrum, resynthAudio);
+          {
+            auto timer = c.time("istft");
+            istft.process(resynthSpectrum, resynthAudio);
+          }
           resynth.samps(i * get<kRank>() + j) = resynthAudio(Slice(0, nFrames));
           if (c.task() &&
               !c.task()->processUpdate(++progressCount, progressTotal))
@@ -130,10 +130,10 @@ public:
     if (!resizeResult.ok()) return resizeResult;
 
     srcTmp = source.samps(0, srcFrames, 0);
-    stft.process(srcTmp, srcSpectrum);
+    stft.process(srcTmp, srcSpectrum, 0);
     STFT::magnitude(srcSpectrum, W);
     tgtTmp = target.samps(0, tgtFrames, 0);
-    stft.process(tgtTmp, tgtSpectrum);
+    stft.process(tgtTmp, tgtSpectrum, 0);
     STFT::magnitude(tgtSpectrum, tgtMag);
     index rank = W.rows();
     auto  outputEnvelopes = FluidTensor<double, 2>(tgtWindows, rank);
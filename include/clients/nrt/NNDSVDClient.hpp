@@ -95,7 +95,7 @@ public:
     auto outputFilters = RealMatrix(get<kMaxRank>(), nBins);
     auto outputEnvelopes = RealMatrix(nWindows, get<kMaxRank>());
 
-    stft.process(tmp, spectrum);
+    stft.process(tmp, spectrum, 0);
     algorithm::STFT::magnitude(spectrum, magnitude);
 
     auto nndsvd = algorithm::NNDSVD();
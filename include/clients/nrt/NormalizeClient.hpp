@@ -91,6 +91,27 @@ public:
     }
     return {};
   }
+
+  // Widens the fitted data range to cover the points of another dataset
+  MessageResult<void> partialFit(DataSetClientRef datasetClient) {
+    auto weakPtr = datasetClient.get();
+    if (auto datasetClientPtr = weakPtr.lock()) {
+      auto dataset = datasetClientPtr->getDataSet();
+      if (dataset.size() == 0)
+        return Error(EmptyDataSet);
+      if (mAlgorithm.initialized() && dataset.pointSize() != mAlgorithm.dims())
+        return Error(WrongPointSize);
+      if (mAlgorithm.initialized() && mAlgorithm.count() == 0)
+        return Error(NoFitCount);
+      mAlgorithm.setMin(get<kMin>());
+      mAlgorithm.setMax(get<kMax>());
+      mAlgorithm.partialFit(dataset.getData());
+    } else {
+      return Error(NoDataSet);
+    }
+    return {};
+  }
+
   MessageResult<void> transform(DataSetClientRef sourceClient,
                                 DataSetClientRef destClient) {
     return _transform(sourceClient, destClient, get<kInvert>() == 1);
@@ -126,6 +147,7 @@ public:
   {
     return defineMessages(
         makeMessage("fit", &NormalizeClient::fit),
+        makeMessage("partialFit", &NormalizeClient::partialFit),
         makeMessage("fitTransform", &NormalizeClient::fitTransform),
         makeMessage("transform", &NormalizeClient::transform),
         makeMessage("transformPoint", &NormalizeClient::transformPoint),
@@ -17,12 +17,13 @@ namespace fluid {
 namespace client {
 namespace pca {
 
-enum { kNumDimensions, kInputBuffer, kOutputBuffer };
+enum { kNumDimensions, kInputBuffer, kOutputBuffer, kMethod };
 
 constexpr auto PCAParams = defineParameters(
     LongParam("numDimensions", "Target Number of Dimensions", 2, Min(1)),
     BufferParam("inputPointBuffer", "Input Point Buffer"),
-    BufferParam("predictionBuffer", "Prediction Buffer"));
+    BufferParam("predictionBuffer", "Prediction Buffer"),
+    EnumParam("method", "Fit Method", 0, "Exact", "Randomized"));
 
 class PCAClient : public FluidBaseClient,
                   AudioIn,
@@ -62,7 +63,7 @@ public:
   {
     if (!mAlgorithm.initialized()) return;
     index k = get<kNumDimensions>();
-    if (k <= 0 || k > mAlgorithm.dims()) return;
+    if (k <= 0 || k > mAlgorithm.dims() || k > mAlgorithm.size()) return;
     InOutBuffersCheck bufCheck(mAlgorithm.dims());
     if (!bufCheck.checkInputs(get<kInputBuffer>().get(),
                               get<kOutputBuffer>().get()))
@@ -85,7 +86,22 @@ public:
     if (!datasetClientPtr) return Error(NoDataSet);
     auto dataSet = datasetClientPtr->getDataSet();
     if (dataSet.size() == 0) return Error(EmptyDataSet);
-    mAlgorithm.init(dataSet.getData());
+    mAlgorithm.init(dataSet.getData(), get<kMethod>(), get<kNumDimensions>());
+    return OK();
+  }
+
+  // Updates the fitted bases with the points of another dataset
+  MessageResult<void> partialFit(DataSetClientRef datasetClient)
+  {
+    auto datasetClientPtr = datasetClient.get().lock();
+    if (!datasetClientPtr) return Error(NoDataSet);
+    auto dataSet = datasetClientPtr->getDataSet();
+    if (dataSet.size() == 0) return Error(EmptyDataSet);
+    if (mAlgorithm.initialized() && dataSet.pointSize() != mAlgorithm.dims())
+      return Error(WrongPointSize);
+    if (mAlgorithm.initialized() && mAlgorithm.count() == 0)
+      return Error(NoFitCount);
+    mAlgorithm.partialFit(dataSet.getData());
     return OK();
   }
 
@@ -106,6 +122,7 @@ public:
     index k = get<kNumDimensions>();
     if (k <= 0) return Error<double>(SmallDim);
     if (k > mAlgorithm.dims()) return Error<double>(LargeDim);
+    if (k > mAlgorithm.size()) return Error<double>(LargeDim);
     auto   srcPtr = sourceClient.get().lock();
     auto   destPtr = destClient.get().lock();
     double result = 0;
@@ -137,6 +154,7 @@ public:
     if (k <= 0) return Error(SmallDim);
     if (k > mAlgorithm.dims()) return Error(LargeDim);
     if (!mAlgorithm.initialized()) return Error(NoDataFitted);
+    if (k > mAlgorithm.size()) return Error(LargeDim);
     InOutBuffersCheck bufCheck(mAlgorithm.dims());
     if (!bufCheck.checkInputs(in.get(), out.get()))
       return Error(bufCheck.error());
@@ -157,6 +175,7 @@ public:
   {
     return defineMessages(
         makeMessage("fit", &PCAClient::fit),
+        makeMessage("partialFit", &PCAClient::partialFit),
         makeMessage("transform", &PCAClient::transform),
         makeMessage("fitTransform", &PCAClient::fitTransform),
         makeMessage("transformPoint", &PCAClient::transformPoint),
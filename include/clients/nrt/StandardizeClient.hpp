@@ -102,6 +102,30 @@ public:
     return {};
   }
 
+  // Extends the current fit with the points in a dataset, e.g. one chunk of
+  // a corpus too large to hold at once. Each point must be passed exactly
+  // once over the fit, so a dataset that grows must be fitted again or have
+  // only its new points passed
+  MessageResult<void> partialFit(DataSetClientRef datasetClient)
+  {
+    auto weakPtr = datasetClient.get();
+    if (auto datasetClientPtr = weakPtr.lock())
+    {
+      auto dataset = datasetClientPtr->getDataSet();
+      if (dataset.size() == 0) return Error(EmptyDataSet);
+      if (mAlgorithm.initialized() && dataset.pointSize() != mAlgorithm.dims())
+        return Error(WrongPointSize);
+      if (mAlgorithm.initialized() && mAlgorithm.count() == 0)
+        return Error(NoFitCount);
+      mAlgorithm.partialFit(dataset.getData());
+    }
+    else
+    {
+      return Error(NoDataSet);
+    }
+    return {};
+  }
+
   MessageResult<void> transform(DataSetClientRef sourceClient,
                                 DataSetClientRef destClient) const
   {
@@ -139,6 +163,7 @@ public:
   {
     return defineMessages(
         makeMessage("fit", &StandardizeClient::fit),
+        makeMessage("partialFit", &StandardizeClient::partialFit),
         makeMessage("fitTransform", &StandardizeClient::fitTransform),
         makeMessage("transform", &StandardizeClient::transform),
         makeMessage("transformPoint", &StandardizeClient::transformPoint),
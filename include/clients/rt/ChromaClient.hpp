@@ -32,7 +32,8 @@ enum ChromaParamIndex {
   kMaxFreq,
   kMaxNChroma,
   kFFT,
-  kMaxFFTSize
+  kMaxFFTSize,
+  kAnalysisName
 };
 
 constexpr auto ChromaParams = defineParameters(
@@ -45,7 +46,12 @@ constexpr auto ChromaParams = defineParameters(
     LongParam<Fixed<true>>("maxNumChroma", "Maximum Number of Chroma Bins", 120, Min(2),
                            MaxFrameSizeUpperLimit<kMaxFFTSize>()),
     FFTParam<kMaxFFTSize>("fftSettings", "FFT Settings", 1024, -1, -1),
-    LongParam<Fixed<true>>("maxFFTSize", "Maxiumm FFT Size", 16384));
+    LongParam<Fixed<true>>("maxFFTSize", "Maxiumm FFT Size", 16384),
+    // Clients with the same name share one analysis, but only if the host
+    // advances FluidContext::hostCycle every cycle. Within a cycle, later
+    // subscribers get the frames of the first one processed, whatever their
+    // own input (see SharedSTFTAnalysis)
+    StringParam<Fixed<true>>("analysisName", "Shared Analysis Name"));
 
 class ChromaClient : public FluidBaseClient, public AudioIn, public ControlOut
 {
@@ -88,16 +94,15 @@ public:
     if (mTracker.changed(get<kFFT>().frameSize(), get<kNChroma>(), get<kRef>(),
                          sampleRate()))
     {
-      mMagnitude.resize(get<kFFT>().frameSize());
       mChroma.resize(get<kNChroma>());
       mAlgorithm.init(get<kNChroma>(), get<kFFT>().frameSize(), get<kRef>(),
                       sampleRate());
     }
 
-    mSTFTBufferedProcess.processInput(
-        mParams, input, c, [&](ComplexMatrixView in) {
-          algorithm::STFT::magnitude(in.row(0), mMagnitude);
-          mAlgorithm.processFrame(mMagnitude, mChroma, get<kMinFreq>(),
+    mSTFTBufferedProcess.processInputMagnitude(
+        mParams, input, c, [&](RealMatrixView magnitudes) {
+          auto magnitude = magnitudes.row(0);
+          mAlgorithm.processFrame(magnitude, mChroma, get<kMinFreq>(),
                                   get<kMaxFreq>(), get<kNorm>());
         });
     for (index i = 0; i < get<kNChroma>(); i++)
@@ -108,7 +113,7 @@ public:
 
   void reset()
   {
-    mSTFTBufferedProcess.reset();
+    mSTFTBufferedProcess.reset(get<kAnalysisName>());
     mAlgorithm.init(get<kNChroma>(), get<kFFT>().frameSize(), get<kRef>(),
                     sampleRate());
   }
@@ -120,7 +125,6 @@ private:
   STFTBufferedProcess<ParamSetViewType, kFFT, false>  mSTFTBufferedProcess;
 
   algorithm::ChromaFilterBank mAlgorithm;
-  FluidTensor<double, 1>      mMagnitude;
   FluidTensor<double, 1>      mChroma;
 };
 } // namespace chroma
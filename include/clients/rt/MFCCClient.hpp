@@ -32,7 +32,8 @@ enum MFCCParamIndex {
   kMaxFreq,
   kMaxNCoefs,
   kFFT,
-  kMaxFFTSize
+  kMaxFFTSize,
+  kAnalysisName
 };
 
 constexpr auto MFCCParams = defineParameters(
@@ -45,7 +46,12 @@ constexpr auto MFCCParams = defineParameters(
     LongParam<Fixed<true>>("maxNumCoeffs", "Maximum Number of Coefficients", 40,
                            MaxFrameSizeUpperLimit<kMaxFFTSize>(), Min(2)),
     FFTParam<kMaxFFTSize>("fftSettings", "FFT Settings", 1024, -1, -1),
-    LongParam<Fixed<true>>("maxFFTSize", "Maxiumm FFT Size", 16384));
+    LongParam<Fixed<true>>("maxFFTSize", "Maxiumm FFT Size", 16384),
+    // Clients with the same name share one analysis, but only if the host
+    // advances FluidContext::hostCycle every cycle. Within a cycle, later
+    // subscribers get the frames of the first one processed, whatever their
+    // own input (see SharedSTFTAnalysis)
+    StringParam<Fixed<true>>("analysisName", "Shared Analysis Name"));
 
 class MFCCClient : public FluidBaseClient, public AudioIn, public ControlOut
 {
@@ -93,7 +99,6 @@ public:
                          get<kNBands>(), get<kMinFreq>(), get<kMaxFreq>(),
                          sampleRate()))
     {
-      mMagnitude.resize(get<kFFT>().frameSize());
       mBands.resize(get<kNBands>());
       mCoefficients.resize(get<kNCoefs>());
       mMelBands.init(get<kMinFreq>(), get<kMaxFreq>(), get<kNBands>(),
@@ -102,10 +107,14 @@ public:
       mDCT.init(get<kNBands>(), get<kNCoefs>());
     }
 
-    mSTFTBufferedProcess.processInput(
-        mParams, input, c, [&](ComplexMatrixView in) {
-          algorithm::STFT::magnitude(in.row(0), mMagnitude);
-          mMelBands.processFrame(mMagnitude, mBands, false, false, true);
+    mSTFTBufferedProcess.processInputMagnitude(
+        mParams, input, c, [&](RealMatrixView magnitudes) {
+          auto magnitude = magnitudes.row(0);
+          {
+            auto timer = c.time("filterbank");
+            mMelBands.processFrame(magnitude, mBands, false, false, true);
+          }
+          auto timer = c.time("dct");
           mDCT.processFrame(mBands, mCoefficients);
         });
     for (index i = 0; i < get<kNCoefs>(); ++i)
@@ -116,8 +125,7 @@ public:
 
   void reset()
   {
-    mSTFTBufferedProcess.reset();
-    mMagnitude.resize(get<kFFT>().frameSize());
+    mSTFTBufferedProcess.reset(get<kAnalysisName>());
     mBands.resize(get<kNBands>());
     mCoefficients.resize(get<kNCoefs>());
     mMelBands.init(get<kMinFreq>(), get<kMaxFreq>(), get<kNBands>(),
@@ -134,7 +142,6 @@ private:
 
   algorithm::MelBands    mMelBands;
   algorithm::DCT         mDCT;
-  FluidTensor<double, 1> mMagnitude;
   FluidTensor<double, 1> mBands;
   FluidTensor<double, 1> mCoefficients;
 };
@@ -32,7 +32,8 @@ enum MFCCParamIndex {
   kNormalize,
   kScale,
   kFFT,
-  kMaxFFTSize
+  kMaxFFTSize,
+  kAnalysisName
 };
 
 constexpr auto MelBandsParams = defineParameters(
@@ -45,7 +46,12 @@ constexpr auto MelBandsParams = defineParameters(
     EnumParam("normalize", "Normalize", 1, "No", "Yes"),
     EnumParam("scale", "Amplitude Scale", 0, "Linear", "dB"),
     FFTParam<kMaxFFTSize>("fftSettings", "FFT Settings", 1024, -1, -1),
-    LongParam<Fixed<true>>("maxFFTSize", "Maxiumm FFT Size", 16384));
+    LongParam<Fixed<true>>("maxFFTSize", "Maxiumm FFT Size", 16384),
+    // Clients with the same name share one analysis, but only if the host
+    // advances FluidContext::hostCycle every cycle. Within a cycle, later
+    // subscribers get the frames of the first one processed, whatever their
+    // own input (see SharedSTFTAnalysis)
+    StringParam<Fixed<true>>("analysisName", "Shared Analysis Name"));
 
 class MelBandsClient : public FluidBaseClient, public AudioIn, public ControlOut
 {
@@ -91,17 +97,17 @@ public:
                          get<kNBands>(), get<kNormalize>(), get<kMinFreq>(),
                          get<kMaxFreq>(), sampleRate()))
     {
-      mMagnitude.resize(get<kFFT>().frameSize());
       mBands.resize(get<kNBands>());
       mMelBands.init(get<kMinFreq>(), get<kMaxFreq>(), get<kNBands>(),
                      get<kFFT>().frameSize(), sampleRate(),
                      get<kFFT>().winSize());
     }
 
-    mSTFTBufferedProcess.processInput(
-        mParams, input, c, [&](ComplexMatrixView in) {
-          algorithm::STFT::magnitude(in.row(0), mMagnitude);
-          mMelBands.processFrame(mMagnitude, mBands, get<kNormalize>() == 1,
+    mSTFTBufferedProcess.processInputMagnitude(
+        mParams, input, c, [&](RealMatrixView magnitudes) {
+          auto magnitude = magnitudes.row(0);
+          auto timer = c.time("filterbank");
+          mMelBands.processFrame(magnitude, mBands, get<kNormalize>() == 1,
                                  false, get<kScale>() == 1);
         });
     for (index i = 0; i < get<kNBands>(); ++i)
@@ -112,7 +118,7 @@ public:
 
   void reset()
   {
-    mSTFTBufferedProcess.reset();
+    mSTFTBufferedProcess.reset(get<kAnalysisName>());
     mMelBands.init(get<kMinFreq>(), get<kMaxFreq>(), get<kNBands>(),
                    get<kFFT>().frameSize(), sampleRate(),
                    get<kFFT>().winSize());
@@ -126,7 +132,6 @@ private:
   STFTBufferedProcess<ParamSetViewType, kFFT, false> mSTFTBufferedProcess;
 
   algorithm::MelBands    mMelBands;
-  FluidTensor<double, 1> mMagnitude;
   FluidTensor<double, 1> mBands;
 };
 } // namespace melbands
@@ -93,7 +93,6 @@ public:
       if (mTrackValues.changed(rank, fftParams.frameSize()))
       {
         tmpFilt.resize(rank, fftParams.frameSize());
-        tmpMagnitude.resize(1, fftParams.frameSize());
         tmpOut.resize(rank);
       }
 
@@ -101,11 +100,11 @@ public:
         tmpFilt.row(i) = filterBuffer.samps(i);
 
       //      controlTrigger(false);
-      mSTFTProcessor.processInput(mParams, input, c, [&](ComplexMatrixView in) {
-        algorithm::STFT::magnitude(in, tmpMagnitude);
-        mNMF.processFrame(tmpMagnitude.row(0), tmpFilt, tmpOut);
-        //          controlTrigger(true);
-      });
+      mSTFTProcessor.processInputMagnitude(
+          mParams, input, c, [&](RealMatrixView magnitudes) {
+            mNMF.processFrame(magnitudes.row(0), tmpFilt, tmpOut);
+            //          controlTrigger(true);
+          });
 
       for (index i = 0; i < rank; ++i)
         output[asUnsigned(i)](0) = static_cast<T>(tmpOut(i));
@@ -116,7 +115,6 @@ private:
   ParameterTrackChanges<index, index> mTrackValues;
   algorithm::NMF                      mNMF;
   FluidTensor<double, 2>              tmpFilt;
-  FluidTensor<double, 2>              tmpMagnitude;
   FluidTensor<double, 1>              tmpOut;
 
   STFTBufferedProcess<ParamSetViewType, kFFT, false> mSTFTProcessor;
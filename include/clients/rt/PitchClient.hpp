@@ -33,7 +33,8 @@ enum PitchParamIndex {
   kMaxFreq,
   kUnit,
   kFFT,
-  kMaxFFTSize
+  kMaxFFTSize,
+  kAnalysisName
 };
 
 constexpr auto PitchParams = defineParameters(
@@ -46,7 +47,12 @@ constexpr auto PitchParams = defineParameters(
     EnumParam("unit", "Frequency Unit", 0, "Hz", "MIDI"),
     FFTParam<kMaxFFTSize>("fftSettings", "FFT Settings", 1024, -1, -1),
     LongParam<Fixed<true>>("maxFFTSize", "Maxiumm FFT Size", 16384, Min(4),
-                           PowerOfTwo{}));
+                           PowerOfTwo{}),
+    // Clients with the same name share one analysis, but only if the host
+    // advances FluidContext::hostCycle every cycle. Within a cycle, later
+    // subscribers get the frames of the first one processed, whatever their
+    // own input (see SharedSTFTAnalysis)
+    StringParam<Fixed<true>>("analysisName", "Shared Analysis Name"));
 
 class PitchClient : public FluidBaseClient, public AudioIn, public ControlOut
 {
@@ -94,24 +100,23 @@ public:
     if (mParamTracker.changed(get<kFFT>().frameSize(), sampleRate()))
     {
       cepstrumF0.init(get<kFFT>().frameSize());
-      mMagnitude.resize(get<kFFT>().frameSize());
     }
 
-    mSTFTBufferedProcess.processInput(
-        mParams, input, c, [&](ComplexMatrixView in) {
-          algorithm::STFT::magnitude(in.row(0), mMagnitude);
+    mSTFTBufferedProcess.processInputMagnitude(
+        mParams, input, c, [&](RealMatrixView magnitudes) {
+          auto magnitude = magnitudes.row(0);
           switch (get<kAlgorithm>())
           {
           case 0:
-            cepstrumF0.processFrame(mMagnitude, mDescriptors, get<kMinFreq>(),
+            cepstrumF0.processFrame(magnitude, mDescriptors, get<kMinFreq>(),
                                     get<kMaxFreq>(), sampleRate());
             break;
           case 1:
-            hps.processFrame(mMagnitude, mDescriptors, 4, get<kMinFreq>(),
+            hps.processFrame(magnitude, mDescriptors, 4, get<kMinFreq>(),
                              get<kMaxFreq>(), sampleRate());
             break;
           case 2:
-            yinFFT.processFrame(mMagnitude, mDescriptors, get<kMinFreq>(),
+            yinFFT.processFrame(magnitude, mDescriptors, get<kMinFreq>(),
                                 get<kMaxFreq>(), sampleRate());
             break;
           }
@@ -131,9 +136,8 @@ public:
   index controlRate() { return get<kFFT>().hopSize(); }
   void  reset()
   {
-    mSTFTBufferedProcess.reset();
+    mSTFTBufferedProcess.reset(get<kAnalysisName>());
     cepstrumF0.init(get<kFFT>().frameSize());
-    mMagnitude.resize(get<kFFT>().frameSize());
   }
 
 private:
@@ -143,7 +147,6 @@ private:
   CepstrumF0             cepstrumF0;
   HPS                    hps;
   YINFFT                 yinFFT;
-  FluidTensor<double, 1> mMagnitude;
   FluidTensor<double, 1> mDescriptors;
 };
 } // namespace pitch
@@ -33,7 +33,8 @@ enum SpectralShapeParamIndex {
   kFreqUnits,
   kAmpMeasure,
   kFFT,
-  kMaxFFTSize
+  kMaxFFTSize,
+  kAnalysisName
 };
 
 constexpr auto SpectralShapeParams = defineParameters(
@@ -44,7 +45,12 @@ constexpr auto SpectralShapeParams = defineParameters(
     EnumParam("power", "Use Power", 0, "No", "Yes"),
     FFTParam<kMaxFFTSize>("fftSettings", "FFT Settings", 1024, -1, -1),
     LongParam<Fixed<true>>("maxFFTSize", "Maxiumm FFT Size", 16384, Min(4),
-                           PowerOfTwo{}));
+                           PowerOfTwo{}),
+    // Clients with the same name share one analysis, but only if the host
+    // advances FluidContext::hostCycle every cycle. Within a cycle, later
+    // subscribers get the frames of the first one processed, whatever their
+    // own input (see SharedSTFTAnalysis)
+    StringParam<Fixed<true>>("analysisName", "Shared Analysis Name"));
 
 class SpectralShapeClient : public FluidBaseClient,
                             public AudioIn,
@@ -90,14 +96,10 @@ public:
     assert(output.size() >= asUnsigned(FluidBaseClient::controlChannelsOut()) &&
            "Too few output channels");
 
-    if (mTracker.changed(get<kFFT>().frameSize(), sampleRate()))
-    { mMagnitude.resize(get<kFFT>().frameSize()); }
-
-    mSTFTBufferedProcess.processInput(
-        mParams, input, c, [&](ComplexMatrixView in) {
-          algorithm::STFT::magnitude(in.row(0), mMagnitude);
+    mSTFTBufferedProcess.processInputMagnitude(
+        mParams, input, c, [&](RealMatrixView magnitudes) {
           mAlgorithm.processFrame(
-              mMagnitude, mDescriptors, sampleRate(), get<kMinFreq>(),
+              magnitudes.row(0), mDescriptors, sampleRate(), get<kMinFreq>(),
               get<kMaxFreq>(), get<kRollOffPercent>(), get<kFreqUnits>() == 1,
               get<kAmpMeasure>() == 1);
         });
@@ -108,16 +110,14 @@ public:
 
   index latency() { return get<kFFT>().winSize(); }
 
-  void reset() { mSTFTBufferedProcess.reset(); }
+  void reset() { mSTFTBufferedProcess.reset(get<kAnalysisName>()); }
 
   index controlRate() { return get<kFFT>().hopSize(); }
 
 private:
-  ParameterTrackChanges<index, double>        mTracker;
   STFTBufferedProcess<ParamSetViewType, kFFT> mSTFTBufferedProcess;
 
   SpectralShape          mAlgorithm;
-  FluidTensor<double, 1> mMagnitude;
   FluidTensor<double, 1> mDescriptors;
 };
 } // namespace spectralshape
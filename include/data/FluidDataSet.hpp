@@ -7,6 +7,7 @@
 #include <iostream>
 #include <string>
 #include <unordered_map>
+#include <utility>
 
 namespace fluid {
 
@@ -17,6 +18,10 @@ class FluidDataSet
 public:
   explicit FluidDataSet() = default;
   ~FluidDataSet() = default;
+  FluidDataSet(const FluidDataSet&) = default;
+  FluidDataSet(FluidDataSet&&) noexcept = default;
+  FluidDataSet& operator=(const FluidDataSet&) = default;
+  FluidDataSet& operator=(FluidDataSet&&) noexcept = default;
 
   // Construct from list of dimensions for each data point,
   // e.g. FluidDataSet(2, 3) is a dataset of 2x3 tensors
@@ -35,6 +40,14 @@ public:
     initFromData();
   }
 
+  // Construct by taking over tensors of ids and data points, without copying
+  FluidDataSet(FluidTensor<idType, 1>&&         ids,
+               FluidTensor<dataType, N + 1>&& points)
+      : mIds(std::move(ids)), mData(std::move(points))
+  {
+    initFromData();
+  }
+
   // Construct from existing tensors of ids and data points
   // (from convertible type for data, typically float -> double)
   template <typename U, typename T = dataType>
@@ -183,6 +196,7 @@ private:
   {
     assert(mIds.rows() == mData.rows());
     mDim = mData.cols();
+    mIndex.reserve(asUnsigned(mIds.size()));
     for (index i = 0; i < mIds.size(); i++) { mIndex.insert({mIds[i], i}); }
   }
 
@@ -1,11 +1,13 @@
 #pragma once
 
+#include <algorithms/public/HNSW.hpp>
 #include <algorithms/public/KDTree.hpp>
 #include <algorithms/public/KMeans.hpp>
 #include <algorithms/public/Normalization.hpp>
 #include <algorithms/public/RobustScaling.hpp>
 #include <algorithms/public/PCA.hpp>
 #include <algorithms/public/MLP.hpp>
+#include <algorithms/public/NeighbourIndex.hpp>
 #include <algorithms/public/UMAP.hpp>
 #include <algorithms/public/Standardization.hpp>
 #include <algorithms/public/LabelSetEncoder.hpp>
@@ -162,6 +164,87 @@ void from_json(const nlohmann::json &j, KDTree &tree) {
   tree.fromFlat(treeData);
 }
 
+// HNSW
+void to_json(nlohmann::json &j, const HNSW &graph) {
+  RealMatrix data = graph.getData();
+  j["rows"] = graph.size();
+  j["cols"] = graph.dims();
+  j["data"] = RealMatrixView(data);
+  j["ids"] = graph.ids();
+  j["links"] = graph.getLinks();
+  j["entry"] = graph.entryPoint();
+  j["maxLinks"] = graph.maxLinks();
+  j["buildWidth"] = graph.buildWidth();
+}
+
+bool check_json(const nlohmann::json &j, const HNSW &) {
+  if (!fluid::check_json(j,
+    {"rows", "cols", "data", "ids", "links", "entry", "maxLinks", "buildWidth"},
+    {JSONTypes::NUMBER, JSONTypes::NUMBER, JSONTypes::ARRAY, JSONTypes::ARRAY,
+      JSONTypes::ARRAY, JSONTypes::NUMBER, JSONTypes::NUMBER, JSONTypes::NUMBER}
+  )) return false;
+  // Searches follow links without bounds checks, so every link must name a
+  // point that exists and has the layer it is linked on
+  if (!j.at("rows").is_number_integer() || !j.at("entry").is_number_integer())
+    return false;
+  index rows = j.at("rows");
+  index entry = j.at("entry");
+  const nlohmann::json &links = j.at("links");
+  if (rows < 0 || asSigned(links.size()) != rows ||
+      asSigned(j.at("data").size()) != rows ||
+      asSigned(j.at("ids").size()) != rows)
+    return false;
+  if (rows == 0 ? entry != -1 : (entry < 0 || entry >= rows)) return false;
+  for (auto &point : links) {
+    if (!point.is_array() || point.empty()) return false;
+    for (index l = 0; l < asSigned(point.size()); l++) {
+      const nlohmann::json &layer = point[asUnsigned(l)];
+      if (!layer.is_array()) return false;
+      for (auto &next : layer) {
+        if (!next.is_number_integer()) return false;
+        index n = next;
+        if (n < 0 || n >= rows || !links[asUnsigned(n)].is_array() ||
+            asSigned(links[asUnsigned(n)].size()) <= l)
+          return false;
+      }
+    }
+  }
+  return j.at("maxLinks").get<index>() >= 2 &&
+         j.at("buildWidth").get<index>() >= 1;
+}
+
+void from_json(const nlohmann::json &j, HNSW &graph) {
+  index rows = j.at("rows");
+  index cols = j.at("cols");
+  RealMatrix data(rows, cols);
+  FluidTensor<std::string, 1> ids(rows);
+  j.at("data").get_to(data);
+  j.at("ids").get_to(ids);
+  graph.init(ids, data, j.at("links").get<HNSW::Links>(),
+             j.at("entry").get<index>(), j.at("maxLinks").get<index>(),
+             j.at("buildWidth").get<index>());
+}
+
+// NeighbourIndex: a KDTree is stored exactly as before, an HNSW graph is told
+// apart by its links
+void to_json(nlohmann::json &j, const NeighbourIndex &search) {
+  if (search.backend() == NeighbourIndex::Backend::kHNSW)
+    j = search.graph();
+  else
+    j = search.tree();
+}
+
+bool check_json(const nlohmann::json &j, const NeighbourIndex &) {
+  return j.contains("links") ? check_json(j, HNSW()) : check_json(j, KDTree());
+}
+
+void from_json(const nlohmann::json &j, NeighbourIndex &search) {
+  if (j.contains("links"))
+    search = NeighbourIndex(j.get<HNSW>());
+  else
+    search = NeighbourIndex(j.get<KDTree>());
+}
+
 // KMeans
 void to_json(nlohmann::json &j, const KMeans &kmeans) {
   RealMatrix means(kmeans.getK(), kmeans.dims());
@@ -197,6 +280,7 @@ void to_json(nlohmann::json &j, const Normalization &normalization) {
   j["min"] = normalization.getMin();
   j["max"] = normalization.getMax();
   j["cols"] = normalization.dims();
+  j["count"] = normalization.count();
 }
 
 bool check_json(const nlohmann::json &j, const Normalization &) {
@@ -216,7 +300,9 @@ void from_json(const nlohmann::json &j, Normalization &normalization) {
   j.at("data_max").get_to(dataMax);
   double min = j.at("min");
   double max = j.at("max");
-  normalization.init(min, max, dataMin, dataMax);
+  // older files have no count, and can't be extended with partialFit
+  index count = j.contains("count") ? j.at("count").get<index>() : 0;
+  normalization.init(min, max, dataMin, dataMax, count);
 }
 
 // RobustScale
@@ -272,6 +358,7 @@ void to_json(nlohmann::json &j, const Standardization &standardization) {
   j["mean"] = RealVectorView(mean);
   j["std"] = RealVectorView(std);
   j["cols"] = standardization.dims();
+  j["count"] = standardization.count();
 }
 
 bool check_json(const nlohmann::json &j, const Standardization &) {
@@ -287,7 +374,8 @@ void from_json(const nlohmann::json &j, Standardization &standardization) {
   RealVector std(cols);
   j.at("mean").get_to(mean);
   j.at("std").get_to(std);
-  standardization.init(mean, std);
+  index count = j.contains("count") ? j.at("count").get<index>() : 0;
+  standardization.init(mean, std, count);
 }
 
 // PCA
@@ -305,6 +393,7 @@ void to_json(nlohmann::json &j, const PCA &pca) {
   j["mean"] = RealVectorView(mean);
   j["rows"] = rows;
   j["cols"] = cols;
+  j["count"] = pca.count();
 }
 
 bool check_json(const nlohmann::json &j, const PCA &) {
@@ -323,7 +412,8 @@ void from_json(const nlohmann::json &j, PCA &pca) {
   j.at("mean").get_to(mean);
   j.at("values").get_to(values);
   j.at("bases").get_to(bases);
-  pca.init(bases, values, mean);
+  index count = j.contains("count") ? j.at("count").get<index>() : 0;
+  pca.init(bases, values, mean, count);
 }
 
 
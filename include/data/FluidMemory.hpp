@@ -0,0 +1,320 @@
+/*
+Part of the Fluid Corpus Manipulation Project (http://www.flucoma.org/)
+Copyright 2017-2019 University of Huddersfield.
+Licensed under the BSD-3 License.
+See license.md file in the project root for full license information.
+This project has received funding from the European Research Council (ERC)
+under the European Union’s Horizon 2020 research and innovation programme
+(grant agreement No 725899).
+*/
+
+/// Allocators for FluidTensor storage. All of them hand out memory aligned to
+/// kTensorAlignment (a cache line, enough for any SIMD load), which lets the
+/// Eigen mappings treat whole tensors as aligned.
+
+#pragma once
+
+#include "FluidIndex.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace fluid {
+
+constexpr size_t kTensorAlignment = 64;
+
+namespace impl {
+
+inline size_t alignUp(size_t n, size_t alignment)
+{
+  return (n + alignment - 1) & ~(alignment - 1);
+}
+
+// Over-allocate with malloc and keep the original pointer just before the
+// aligned block, since aligned operator new needs C++17
+inline void* alignedMalloc(size_t bytes, size_t alignment)
+{
+  void* raw = std::malloc(bytes + alignment + sizeof(void*));
+  if (!raw) throw std::bad_alloc();
+  auto  address = reinterpret_cast<std::uintptr_t>(raw) + sizeof(void*);
+  void* aligned = reinterpret_cast<void*>(alignUp(address, alignment));
+  static_cast<void**>(aligned)[-1] = raw;
+  return aligned;
+}
+
+inline void alignedFree(void* p)
+{
+  if (p) std::free(static_cast<void**>(p)[-1]);
+}
+
+// Constructing without arguments leaves trivially copyable elements (which
+// includes std::complex, whose own default constructor zeroes) unwritten, so
+// that std::vector::resize(n) costs nothing per element. FluidTensor asks for
+// zeros explicitly everywhere except its uninitialized paths
+struct DefaultInitConstruct
+{
+  template <typename U>
+  std::enable_if_t<std::is_trivially_copyable<U>::value> construct(U*) noexcept
+  {}
+
+  template <typename U>
+  std::enable_if_t<!std::is_trivially_copyable<U>::value> construct(U* p)
+  {
+    ::new (static_cast<void*>(p)) U;
+  }
+
+  template <typename U, typename... Args>
+  void construct(U* p, Args&&... args)
+  {
+    ::new (static_cast<void*>(p)) U(std::forward<Args>(args)...);
+  }
+};
+
+} // namespace impl
+
+/// Default FluidTensor allocator: plain heap storage, aligned
+template <typename T, size_t Alignment = kTensorAlignment>
+class AlignedAllocator : public impl::DefaultInitConstruct
+{
+  static_assert((Alignment & (Alignment - 1)) == 0,
+                "Alignment must be a power of two");
+
+public:
+  using value_type = T;
+  static constexpr size_t alignment = Alignment;
+
+  template <typename U>
+  struct rebind
+  {
+    using other = AlignedAllocator<U, Alignment>;
+  };
+
+  AlignedAllocator() noexcept = default;
+  template <typename U>
+  AlignedAllocator(const AlignedAllocator<U, Alignment>&) noexcept
+  {}
+
+  T* allocate(size_t n)
+  {
+    if (n > std::numeric_limits<size_t>::max() / sizeof(T))
+      throw std::bad_alloc();
+    return static_cast<T*>(impl::alignedMalloc(n * sizeof(T), Alignment));
+  }
+
+  void deallocate(T* p, size_t) noexcept { impl::alignedFree(p); }
+
+  template <typename U>
+  bool operator==(const AlignedAllocator<U, Alignment>&) const noexcept
+  {
+    return true;
+  }
+  template <typename U>
+  bool operator!=(const AlignedAllocator<U, Alignment>&) const noexcept
+  {
+    return false;
+  }
+};
+
+/// A monotonic arena: allocation bumps a pointer through large blocks and
+/// deallocation does nothing; reset() reclaims everything at once, keeping the
+/// blocks for reuse. Meant for the scratch tensors of a single process() call.
+/// Not thread safe
+class MemoryArena
+{
+public:
+  static constexpr size_t kDefaultBlockSize = 1 << 20;
+
+  explicit MemoryArena(size_t blockSize = kDefaultBlockSize)
+      : mBlockSize(std::max(blockSize, kTensorAlignment))
+  {}
+
+  MemoryArena(const MemoryArena&) = delete;
+  MemoryArena& operator=(const MemoryArena&) = delete;
+
+  ~MemoryArena()
+  {
+    for (auto& b : mBlocks) impl::alignedFree(b.data);
+  }
+
+  void* allocate(size_t bytes)
+  {
+    bytes = impl::alignUp(std::max<size_t>(bytes, 1), kTensorAlignment);
+    while (mCurrent < mBlocks.size())
+    {
+      Block& b = mBlocks[mCurrent];
+      if (b.size - mUsed >= bytes)
+      {
+        void* p = b.data + mUsed;
+        mUsed += bytes;
+        return p;
+      }
+      mCurrent++;
+      mUsed = 0;
+    }
+    size_t size = std::max(bytes, mBlockSize);
+    mBlocks.push_back(
+        {static_cast<char*>(impl::alignedMalloc(size, kTensorAlignment)),
+         size});
+    mCurrent = mBlocks.size() - 1;
+    mUsed = bytes;
+    return mBlocks.back().data;
+  }
+
+  void deallocate(void*, size_t) noexcept {}
+
+  // Invalidates everything allocated so far
+  void reset() noexcept
+  {
+    mCurrent = 0;
+    mUsed = 0;
+  }
+
+  size_t capacity() const
+  {
+    size_t total = 0;
+    for (auto& b : mBlocks) total += b.size;
+    return total;
+  }
+
+private:
+  struct Block
+  {
+    char*  data;
+    size_t size;
+  };
+
+  std::vector<Block> mBlocks;
+  size_t             mBlockSize;
+  size_t             mCurrent{0};
+  size_t             mUsed{0};
+};
+
+/// Recycles freed blocks on per-size free lists, sizes rounded up to powers of
+/// two, so that tensors of recurring shapes stop reaching the system
+/// allocator after the first round. Memory goes back to the system when the
+/// pool is destroyed. Not thread safe
+class MemoryPool
+{
+public:
+  MemoryPool() = default;
+  MemoryPool(const MemoryPool&) = delete;
+  MemoryPool& operator=(const MemoryPool&) = delete;
+
+  ~MemoryPool() { release(); }
+
+  void* allocate(size_t bytes)
+  {
+    size_t c = sizeClass(bytes);
+    if (c >= mFree.size()) mFree.resize(c + 1);
+    auto& list = mFree[c];
+    if (!list.empty())
+    {
+      void* p = list.back();
+      list.pop_back();
+      return p;
+    }
+    void* p = impl::alignedMalloc(classSize(c), kTensorAlignment);
+    mAllocated.push_back(p);
+    return p;
+  }
+
+  void deallocate(void* p, size_t bytes)
+  {
+    if (!p) return;
+    size_t c = sizeClass(bytes);
+    assert(c < mFree.size());
+    mFree[c].push_back(p);
+  }
+
+  // Frees every block; only safe once nothing allocated from the pool is live
+  void release()
+  {
+    for (void* p : mAllocated) impl::alignedFree(p);
+    mAllocated.clear();
+    mFree.clear();
+  }
+
+private:
+  static size_t classSize(size_t c) { return kTensorAlignment << c; }
+
+  static size_t sizeClass(size_t bytes)
+  {
+    size_t c = 0;
+    while (classSize(c) < bytes) c++;
+    return c;
+  }
+
+  std::vector<std::vector<void*>> mFree;
+  std::vector<void*>              mAllocated;
+};
+
+/// std-style allocator over a MemoryArena or MemoryPool, which must outlive
+/// any container using it
+template <typename T, typename Resource>
+class ResourceAllocator : public impl::DefaultInitConstruct
+{
+public:
+  using value_type = T;
+  static constexpr size_t alignment = kTensorAlignment;
+
+  template <typename U>
+  struct rebind
+  {
+    using other = ResourceAllocator<U, Resource>;
+  };
+
+  ResourceAllocator(Resource& resource) noexcept : mResource(&resource) {}
+  template <typename U>
+  ResourceAllocator(const ResourceAllocator<U, Resource>& other) noexcept
+      : mResource(other.resource())
+  {}
+
+  T* allocate(size_t n)
+  {
+    return static_cast<T*>(mResource->allocate(n * sizeof(T)));
+  }
+
+  void deallocate(T* p, size_t n) { mResource->deallocate(p, n * sizeof(T)); }
+
+  Resource* resource() const noexcept { return mResource; }
+
+  template <typename U>
+  bool operator==(const ResourceAllocator<U, Resource>& other) const noexcept
+  {
+    return mResource == other.resource();
+  }
+  template <typename U>
+  bool operator!=(const ResourceAllocator<U, Resource>& other) const noexcept
+  {
+    return mResource != other.resource();
+  }
+
+private:
+  Resource* mResource;
+};
+
+template <typename T>
+using ArenaAllocator = ResourceAllocator<T, MemoryArena>;
+
+template <typename T>
+using PoolAllocator = ResourceAllocator<T, MemoryPool>;
+
+/// Alignment an allocator guarantees, or 0 if it says nothing
+template <typename Allocator, typename = void>
+struct AllocatorAlignment : std::integral_constant<size_t, 0>
+{};
+
+template <typename Allocator>
+struct AllocatorAlignment<Allocator,
+                          decltype(void(Allocator::alignment))>
+    : std::integral_constant<size_t, Allocator::alignment>
+{};
+
+} // namespace fluid
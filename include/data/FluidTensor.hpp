@@ -13,6 +13,7 @@ under the European Union’s Horizon 2020 research and innovation programme
 #pragma once
 
 #include "FluidIndex.hpp"
+#include "FluidMemory.hpp"
 #include "FluidTensor_Support.hpp"
 #include <array>
 #include <cassert>
@@ -22,14 +23,23 @@ under the European Union’s Horizon 2020 research and innovation programme
 #include <vector>
 
 namespace fluid {
-/// FluidTensor is the main container class.
-template <typename T, size_t N>
+/// FluidTensor is the main container class. Storage comes from Allocator,
+/// which by default gives kTensorAlignment-aligned heap memory
+template <typename T, size_t N,
+          typename Allocator =
+              AlignedAllocator<std::remove_const_t<std::remove_reference_t<T>>>>
 class FluidTensor;
 /// FluidTensorView gives you a view over some part of the container or a
 /// pointer
 template <typename T, size_t N>
 class FluidTensorView;
 
+/// Tag for constructors that allocate without initialising the elements, for
+/// tensors whose every element is about to be written anyway
+struct UninitializedTag
+{};
+constexpr UninitializedTag Uninitialized{};
+
 ///*****************************************************************************
 /// Printing
 namespace impl {
@@ -56,16 +66,17 @@ printTensorThing(std::ostream& o, TensorThing& t)
 ///*****************************************************************************
 /// FluidTensor
 
-template <typename T, size_t N>
+template <typename T, size_t N, typename Allocator>
 class FluidTensor //: public FluidTensorBase<T,N>
 {
+  using value_type = std::remove_const_t<std::remove_reference_t<T>>;
   // embed this so we can change our mind
-  using Container =
-      std::vector<std::remove_const_t<std::remove_reference_t<T>>>;
+  using Container = std::vector<value_type, Allocator>;
 
 public:
   static constexpr size_t order = N;
   using type = std::remove_reference_t<T>;
+  using allocator_type = Allocator;
   // expose this so we can use as an iterator over elements
   using iterator = typename Container::iterator;
   using const_iterator = typename Container::const_iterator;
@@ -74,12 +85,18 @@ public:
   explicit FluidTensor() = default;
   ~FluidTensor() = default;
 
+  /// Empty, with a given allocator (e.g. an ArenaAllocator); size it with
+  /// resize()
+  explicit FluidTensor(const Allocator& alloc) : mContainer(alloc) {}
+
   // Move
   FluidTensor(FluidTensor&&) noexcept = default;
   FluidTensor& operator=(FluidTensor&&) noexcept = default;
 
   // Copy
-  FluidTensor(const FluidTensor& x) noexcept { *this = x; }
+  FluidTensor(const FluidTensor& x) noexcept
+      : mContainer(x.mContainer), mDesc(x.mDesc)
+  {}
   FluidTensor& operator=(const FluidTensor& x) noexcept
   {
     mContainer = x.mContainer;
@@ -88,8 +105,8 @@ public:
   }
 
   /// Conversion constructors
-  template <typename U, size_t M>
-  explicit FluidTensor(const FluidTensor<U, M>& x)
+  template <typename U, size_t M, typename A>
+  explicit FluidTensor(const FluidTensor<U, M, A>& x)
       : mContainer(x.size()), mDesc(x.descriptor())
   {
     static_assert(std::is_convertible<U, T>::value,
@@ -110,8 +127,8 @@ public:
   /// Conversion assignment
 //  template <typename U, template <typename, size_t> class O, size_t M = N>
 //  std::enable_if_t<std::is_same<FluidTensor<U, N>, O<U, M>>{}(), FluidTensor&>
-  template<typename U>
-  FluidTensor& operator=(const FluidTensor<U, N>& x)
+  template <typename U, typename A>
+  FluidTensor& operator=(const FluidTensor<U, N, A>& x)
   {
     mDesc = x.descriptor();
     mContainer.assign(x.begin(), x.end());
@@ -122,6 +139,16 @@ public:
   template <typename... Dims,
             typename = std::enable_if_t<isIndexSequence<Dims...>()>>
   FluidTensor(Dims... dims) : mDesc(dims...)
+  {
+    static_assert(sizeof...(dims) == N, "Number of dimensions doesn't match");
+    mContainer.resize(asUnsigned(mDesc.size), value_type());
+  }
+
+  /// As above, but leaves trivial element types uninitialized (with the
+  /// default allocator), e.g. FluidTensor<double, 2>(Uninitialized, r, c)
+  template <typename... Dims,
+            typename = std::enable_if_t<isIndexSequence<Dims...>()>>
+  FluidTensor(UninitializedTag, Dims... dims) : mDesc(dims...)
   {
     static_assert(sizeof...(dims) == N, "Number of dimensions doesn't match");
     mContainer.resize(asUnsigned(mDesc.size));
@@ -203,12 +230,13 @@ public:
   /// 1D copy from std::vector
   template <typename U = T, size_t D = N, typename = std::enable_if_t<D == 1>()>
   FluidTensor(Container&& input)
-      : mContainer(input), mDesc(0, {asSigned(input.size())})
+      : mContainer(std::move(input)), mDesc(0, {asSigned(mContainer.size())})
   {}
 
-  template <typename U = T, size_t D = N, typename = std::enable_if_t<D == 1>()>
-  FluidTensor(Container& input)
-      : mContainer(input), mDesc(0, {asSigned(input.size())})
+  template <typename A, size_t D = N, typename = std::enable_if_t<D == 1>()>
+  FluidTensor(const std::vector<value_type, A>& input)
+      : mContainer(input.begin(), input.end()),
+        mDesc(0, {asSigned(input.size())})
   {}
 
 
@@ -311,17 +339,39 @@ public:
   template <typename... Dims,
             typename = std::enable_if_t<isIndexSequence<Dims...>()>>
   void resize(Dims... dims)
+  {
+    static_assert(sizeof...(dims) == N, "Number of dimensions doesn't match");
+    mDesc = FluidTensorSlice<N>(dims...);
+    mContainer.resize(asUnsigned(mDesc.size), value_type());
+  }
+
+  /// resize() without zeroing any elements it adds
+  template <typename... Dims,
+            typename = std::enable_if_t<isIndexSequence<Dims...>()>>
+  void resize(UninitializedTag, Dims... dims)
   {
     static_assert(sizeof...(dims) == N, "Number of dimensions doesn't match");
     mDesc = FluidTensorSlice<N>(dims...);
     mContainer.resize(asUnsigned(mDesc.size));
   }
 
+  /// New extents over the same elements in the same (row major) order; the
+  /// total size must not change, and nothing is copied
+  template <typename... Dims,
+            typename = std::enable_if_t<isIndexSequence<Dims...>()>>
+  void reshape(Dims... dims)
+  {
+    static_assert(sizeof...(dims) == N, "Number of dimensions doesn't match");
+    FluidTensorSlice<N> desc(dims...);
+    assert(desc.size == size() && "Reshape must keep the number of elements");
+    mDesc = desc;
+  }
+
   void resizeDim(index dim, index amount)
   {
     if (amount == 0) return;
     mDesc.grow(dim, amount);
-    mContainer.resize(asUnsigned(mDesc.size));
+    mContainer.resize(asUnsigned(mDesc.size), value_type());
   }
 
   // Specialise for N=1
@@ -384,8 +434,8 @@ private:
 };
 
 /// A 0-dim container is just a scalar
-template <typename T>
-class FluidTensor<T, 0>
+template <typename T, typename Allocator>
+class FluidTensor<T, 0, Allocator>
 {
 public:
   static constexpr size_t order = 0;
@@ -456,7 +506,8 @@ public:
   gurranteed memory leak, i.e. you can't do FluidTensorView<double,1> r =
   FluidTensor(double,2);
   **********/
-  FluidTensorView(FluidTensor<T, N>&& r) = delete;
+  template <typename A>
+  FluidTensorView(FluidTensor<T, N, A>&& r) = delete;
 
 
   // Move construction is allowed
@@ -493,7 +544,8 @@ public:
   }
 
   // Copy from Tensor of same type
-  FluidTensorView& operator=(const FluidTensor<T, N>& x)
+  template <typename A>
+  FluidTensorView& operator=(const FluidTensor<T, N, A>& x)
   {
     assert(sameExtents(mDesc, x.descriptor()));
     std::array<index, N> a;
@@ -536,8 +588,8 @@ public:
   }
 
   // Converting copy from Tensor
-  template <typename U>
-  FluidTensorView& operator=(FluidTensor<U, N>& x)
+  template <typename U, typename A>
+  FluidTensorView& operator=(FluidTensor<U, N, A>& x)
   {
     static_assert(std::is_convertible<U, T>::value,  "Can't convert between types");
     assert(sameExtents(*this, x));
@@ -548,6 +600,19 @@ public:
   //implict cast to const
   operator FluidTensorView<const T, N>() const { return {mDesc, mRef}; }
 
+  /// A view of the same elements with other extents (and possibly another
+  /// number of dimensions), without copying. Only for contiguous views, i.e.
+  /// not strided slices or transposes
+  template <typename... Dims,
+            typename = std::enable_if_t<isIndexSequence<Dims...>()>>
+  FluidTensorView<T, sizeof...(Dims)> reshape(Dims... dims) const
+  {
+    assert(mDesc.contiguous() && "Can only reshape a contiguous view");
+    FluidTensorSlice<sizeof...(Dims)> desc(dims...);
+    assert(desc.size == size() && "Reshape must keep the number of elements");
+    return {desc, data()};
+  }
+
   
   template <typename... Dims,
             typename = std::enable_if_t<isIndexSequence<Dims...>()>>
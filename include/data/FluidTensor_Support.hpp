@@ -358,7 +358,7 @@ struct FluidTensorSlice
   operator()(Dims... dims) const
   {
     static_assert(sizeof...(Dims) == N, "");
-    size_t args[N]{Index(dims)...};
+    index args[N]{index(dims)...};
     return std::inner_product(args, args + N, strides.begin(), index(0));
   }
 
@@ -412,6 +412,20 @@ struct FluidTensorSlice
   }
   bool operator!=(const FluidTensorSlice& rhs) const { return !(*this == rhs); }
 
+  // True if the elements are laid out densely in row major order, so that the
+  // slice can be reinterpreted with other extents
+  bool contiguous() const
+  {
+    index expected = 1;
+    for (index i = N - 1; i >= 0; --i)
+    {
+      size_t d = asUnsigned(i);
+      if (extents[d] != 1 && strides[d] != expected) return false;
+      expected *= extents[d];
+    }
+    return true;
+  }
+
   index                size;      // num of elements
   index                start = 0; // offset
   bool                 transposed = false;
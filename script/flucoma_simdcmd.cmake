@@ -8,8 +8,15 @@
 
 include_guard()
 
+option(FLUID_RUNTIME_DISPATCH "On x86, build for the baseline instruction set and let the hot kernels in VectorKernels.hpp pick AVX2 or AVX-512 at run time" OFF)
+
 if(CMAKE_SYSTEM_PROCESSOR MATCHES "amd64.*|x86_64.*|AMD64.*|i686.*|i386.*|x86.*")
-  if(MSVC)
+  if(FLUID_RUNTIME_DISPATCH)
+    # SSE2 is already the x86-64 baseline
+    if(NOT MSVC AND CMAKE_SIZEOF_VOID_P EQUAL 4)
+      set(SIMD_OPT -msse2)
+    endif()
+  elseif(MSVC)
     set(SIMD_OPT /arch:AVX)
   else()
     set(SIMD_OPT -mavx)